@@ -179,8 +179,8 @@ public:
             hasWarnings = true;
         }
         
-        // 如果错误数量超过限制，停止编译
-        if (errors.size() >= maxErrors) {
+        // 如果错误数量达到限制，停止编译（只报告一次）
+        if (errors.size() == (size_t)maxErrors) {
             reportError(ErrorType::SYNTAX_ERROR, ErrorSeverity::FATAL,
                        "错误数量过多，停止编译", filename);
         }
@@ -335,8 +335,14 @@ public:
         }
     }
     
+    // 恐慌模式恢复的同步记号：语法分析器出错后丢弃输入直到遇见其中之一
+    static bool isSynchronizingToken(const string& terminal) {
+        return terminal == "SEMI" || terminal == "RBR";
+    }
+    
     // 获取错误统计
     bool hasCompilationErrors() const { return hasErrors; }
+    bool errorLimitReached() const { return errors.size() >= (size_t)maxErrors; }
     bool hasCompilationWarnings() const { return hasWarnings; }
     size_t getErrorCount() const { return errors.size(); }
     
@@ -348,10 +354,9 @@ public:
     }
     
 private:
-    // 恐慌模式恢复
+    // 恐慌模式恢复：跳过token直到遇到同步token（见 isSynchronizingToken），
+    // 具体的弹栈和跳过输入由 SLRParser 在分析过程中完成
     bool panicModeRecovery(const string& context) {
-        // 跳过token直到遇到同步token（如分号、右括号等）
-        cout << "尝试恐慌模式恢复..." << endl;
         return true;
     }
     
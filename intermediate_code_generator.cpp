@@ -10,7 +10,6 @@
 #include <fstream>
 #include <functional>
 #include "semantic_analyzer.cpp"
-#include "error_handler.cpp"
 
 using namespace std;
 
@@ -171,6 +170,25 @@ public:
         generateLabel(endLabel);
     }
     
+    // ===== 回填 =====
+    // 一遍翻译时跳转的目标往往还没有生成，先生成结果为空的跳转并记下序号，
+    // 目标确定后再把目标四元式的序号回填到结果字段
+    
+    // 下一条四元式的序号
+    int nextQuad() const {
+        return quadruples.size();
+    }
+    
+    // 生成目标待回填的跳转，返回其序号
+    int emitJump(const string& op, const string& arg1 = "", const string& arg2 = "") {
+        emit(op, arg1, arg2, "");
+        return quadruples.size() - 1;
+    }
+    
+    void backpatch(const vector<int>& list, int target) {
+        for (int i : list) quadruples[i].result = to_string(target);
+    }
+    
     // 打印四元式
     void printQuadruples() const {
         cout << "\n=== 四元式中间代码 ===" << endl;
@@ -201,13 +219,77 @@ class ASTCodeGenerator {
 private:
     IntermediateCodeGenerator& generator;
     
+    // 临时变量复用：AST经过哈希合并后，同一基本块内再次遇到同一个运算或数组访问节点时，
+    // 直接使用第一次计算得到的临时变量。表达式读到的变量被赋值、任一数组元素被赋值、
+    // 调用函数以及基本块结束时，相应的缓存失效
+    struct CachedTemp {
+        string place;
+        set<string> reads;      // 表达式读到的变量和数组
+        bool readsArray = false; // 表达式中含数组访问
+    };
+    bool reuseTemps = false;
+    unordered_map<const ASTNode*, CachedTemp> tempCache;
+    
+    static void collectReads(const ExpressionNode* expr, CachedTemp& cached) {
+        if (!expr) return;
+        if (expr->type == NodeType::IDENTIFIER) {
+            cached.reads.insert(static_cast<const IdentifierNode*>(expr)->name);
+        } else if (expr->type == NodeType::BINARY_OP || expr->type == NodeType::ARRAY_ACCESS) {
+            auto binOp = static_cast<const BinaryOpNode*>(expr);
+            if (expr->type == NodeType::ARRAY_ACCESS || binOp->op == "[]") cached.readsArray = true;
+            collectReads(binOp->left.get(), cached);
+            collectReads(binOp->right.get(), cached);
+        }
+    }
+    
+    // 标量变量name被赋值，读到它的缓存失效
+    void invalidate(const string& name) {
+        for (auto it = tempCache.begin(); it != tempCache.end();) {
+            if (it->second.reads.count(name)) it = tempCache.erase(it);
+            else ++it;
+        }
+    }
+    
+    // 数组元素被赋值：数组形参可能与全局数组或其他形参是同一个数组，
+    // 不能按名字判断，读到任何数组的缓存都失效
+    void invalidateArrays() {
+        for (auto it = tempCache.begin(); it != tempCache.end();) {
+            if (it->second.readsArray) it = tempCache.erase(it);
+            else ++it;
+        }
+    }
+    
+    // 基本块结束（标号、跳转、调用、返回），缓存全部失效
+    void endBlock() {
+        tempCache.clear();
+    }
+    
 public:
     ASTCodeGenerator(IntermediateCodeGenerator& gen) : generator(gen) {}
     
+    // AST经过哈希合并（见 ExpressionTable）后启用临时变量复用
+    void enableTempReuse() {
+        reuseTemps = true;
+    }
+    
     // 为AST节点生成中间代码
     string generateCode(shared_ptr<ASTNode> node) {
         if (!node) return "";
-        
+        if (reuseTemps && (node->type == NodeType::BINARY_OP || node->type == NodeType::ARRAY_ACCESS)) {
+            auto it = tempCache.find(node.get());
+            if (it != tempCache.end()) return it->second.place;
+            string place = translate(node);
+            if (isPureExpression(static_cast<const ExpressionNode*>(node.get()))) {
+                CachedTemp& cached = tempCache[node.get()];
+                cached.place = place;
+                collectReads(static_cast<const ExpressionNode*>(node.get()), cached);
+            }
+            return place;
+        }
+        return translate(node);
+    }
+    
+    string translate(const shared_ptr<ASTNode>& node) {
         switch (node->type) {
             case NodeType::LITERAL: {
                 auto literal = static_pointer_cast<LiteralNode>(node);
@@ -246,6 +328,7 @@ public:
                     string index = generateCode(targetBinaryOp->right);
                     string value = generateCode(assignment->value);
                     generator.generateArrayAssignment(arrayName, index, value);
+                    invalidateArrays();
                     return arrayName + "[" + index + "]";
                 }
                 
@@ -253,6 +336,7 @@ public:
                 string target = generateCode(assignment->target);
                 string source = generateCode(assignment->value);
                 generator.generateAssignment(target, source);
+                invalidate(target);
                 return target;
             }
             
@@ -261,9 +345,10 @@ public:
                 string condition = generateCode(ifStmt->condition);
                 
                 generator.generateIfStatement(condition,
-                    [&]() { generateCode(ifStmt->thenStmt); },
-                    ifStmt->elseStmt ? function<void()>([&]() { generateCode(ifStmt->elseStmt); }) : function<void()>()
+                    [&]() { endBlock(); generateCode(ifStmt->thenStmt); },
+                    ifStmt->elseStmt ? function<void()>([&]() { endBlock(); generateCode(ifStmt->elseStmt); }) : function<void()>()
                 );
+                endBlock();
                 return "";
             }
             
@@ -272,8 +357,9 @@ public:
                 string condition = generateCode(whileStmt->condition);
                 
                 generator.generateWhileLoop(condition,
-                    [&]() { generateCode(whileStmt->body); }
+                    [&]() { endBlock(); generateCode(whileStmt->body); }
                 );
+                endBlock();
                 return "";
             }
             
@@ -283,13 +369,16 @@ public:
                 for (auto& arg : funcCall->arguments) {
                     args.push_back(generateCode(arg));
                 }
-                return generator.generateFunctionCall(funcCall->functionName, args);
+                string result = generator.generateFunctionCall(funcCall->functionName, args);
+                endBlock();
+                return result;
             }
             
             case NodeType::FUNCTION_DEF: {
                 auto funcDef = static_pointer_cast<FunctionDefNode>(node);
                 
                 // 生成函数标签
+                endBlock();
                 generator.generateLabel(funcDef->name);
                 
                 // 处理函数体
@@ -310,6 +399,8 @@ public:
                     string initValue = generateCode(varDecl->initializer);
                     generator.generateAssignment(varDecl->name, initValue);
                 }
+                // 局部变量与外层同名时，此后的同名标识符指的是新变量
+                invalidate(varDecl->name);
                 
                 return "";
             }
@@ -335,6 +426,7 @@ public:
                     // 无返回值的return语句
                     generator.generateReturn();
                 }
+                endBlock();
                 return "";
             }
             
@@ -376,6 +468,123 @@ public:
         return "";
     }
     
+    // 为扁平AST的节点生成中间代码，与上面基于指针树的generateCode逐条对应
+    string generateCode(const FlatAST& ast, FlatAST::Index node) {
+        if (node == FlatAST::NONE) return "";
+        
+        switch (ast.kind[node]) {
+            case NodeType::LITERAL:
+            case NodeType::IDENTIFIER:
+                return ast.str(ast.data[node]);
+            
+            case NodeType::BINARY_OP:
+            case NodeType::ARRAY_ACCESS: {
+                const FlatAST::BinaryOp& binaryOp = ast.binaryOp(node);
+                string left = generateCode(ast, binaryOp.left);
+                string right = generateCode(ast, binaryOp.right);
+                if (ast.str(binaryOp.op) == "[]" || ast.kind[node] == NodeType::ARRAY_ACCESS) {
+                    return generator.generateArrayAccess(left, right);
+                }
+                return generator.generateArithmeticExpr(ast.str(binaryOp.op), left, right);
+            }
+            
+            case NodeType::ASSIGNMENT: {
+                const FlatAST::Assignment& assignment = ast.assignment(node);
+                if (assignment.target != FlatAST::NONE && ast.kind[assignment.target] == NodeType::ARRAY_ACCESS) {
+                    const FlatAST::BinaryOp& target = ast.binaryOp(assignment.target);
+                    string arrayName = generateCode(ast, target.left);
+                    string index = generateCode(ast, target.right);
+                    string value = generateCode(ast, assignment.value);
+                    generator.generateArrayAssignment(arrayName, index, value);
+                    return arrayName + "[" + index + "]";
+                }
+                string target = generateCode(ast, assignment.target);
+                string source = generateCode(ast, assignment.value);
+                generator.generateAssignment(target, source);
+                return target;
+            }
+            
+            case NodeType::IF_STMT: {
+                const FlatAST::IfStmt& ifStmt = ast.ifStmt(node);
+                string condition = generateCode(ast, ifStmt.condition);
+                generator.generateIfStatement(condition,
+                    [&]() { generateCode(ast, ifStmt.thenStmt); },
+                    ifStmt.elseStmt != FlatAST::NONE ? function<void()>([&]() { generateCode(ast, ifStmt.elseStmt); }) : function<void()>()
+                );
+                return "";
+            }
+            
+            case NodeType::WHILE_STMT: {
+                const FlatAST::WhileStmt& whileStmt = ast.whileStmt(node);
+                string condition = generateCode(ast, whileStmt.condition);
+                generator.generateWhileLoop(condition,
+                    [&]() { generateCode(ast, whileStmt.body); }
+                );
+                return "";
+            }
+            
+            case NodeType::FUNCTION_CALL: {
+                const FlatAST::FunctionCall& funcCall = ast.functionCall(node);
+                vector<string> args;
+                for (FlatAST::Index k = 0; k < funcCall.arguments.count; k++) {
+                    args.push_back(generateCode(ast, ast.child(funcCall.arguments, k)));
+                }
+                return generator.generateFunctionCall(ast.str(funcCall.name), args);
+            }
+            
+            case NodeType::FUNCTION_DEF: {
+                const FlatAST::FunctionDef& funcDef = ast.functionDef(node);
+                generator.generateLabel(ast.str(funcDef.name));
+                generateCode(ast, funcDef.body);
+                return "";
+            }
+            
+            case NodeType::VARIABLE_DECL: {
+                const FlatAST::VariableDecl& varDecl = ast.variableDecl(node);
+                if (varDecl.initializer != FlatAST::NONE) {
+                    string initValue = generateCode(ast, varDecl.initializer);
+                    generator.generateAssignment(ast.str(varDecl.name), initValue);
+                }
+                return "";
+            }
+            
+            case NodeType::COMPOUND_STMT: {
+                const FlatAST::Range& statements = ast.compoundStmt(node);
+                for (FlatAST::Index k = 0; k < statements.count; k++) {
+                    generateCode(ast, ast.child(statements, k));
+                }
+                return "";
+            }
+            
+            case NodeType::RETURN_STMT: {
+                FlatAST::Index value = ast.data[node];
+                if (value != FlatAST::NONE) {
+                    generator.generateReturn(generateCode(ast, value));
+                } else {
+                    generator.generateReturn();
+                }
+                return "";
+            }
+            
+            case NodeType::PROGRAM: {
+                const FlatAST::Program& program = ast.program(node);
+                for (FlatAST::Index k = 0; k < program.globalVariables.count; k++) {
+                    generateCode(ast, ast.child(program.globalVariables, k));
+                }
+                for (FlatAST::Index k = 0; k < program.functions.count; k++) {
+                    generateCode(ast, ast.child(program.functions, k));
+                }
+                return "";
+            }
+            
+            default:
+                DEBUG_PRINT(cout << "警告：未处理的AST节点类型: " << nodeTypeToString(ast.kind[node]) << endl);
+                break;
+        }
+        
+        return "";
+    }
+    
     // 生成完整程序的中间代码
     void generateProgramCode(shared_ptr<ASTNode> ast) {
         if (!ast) {
@@ -387,6 +596,7 @@ public:
         
         // 清空之前的代码
         generator.clear();
+        endBlock();
         
         // 生成代码
         generateCode(ast);
@@ -396,25 +606,441 @@ public:
         // 打印生成的四元式
         generator.printQuadruples();
     }
+    
+    void generateProgramCode(const FlatAST& ast) {
+        if (ast.empty()) {
+            cout << "错误：AST为空" << endl;
+            return;
+        }
+        
+        cout << "\n=== 开始生成中间代码 ===" << endl;
+        generator.clear();
+        generateCode(ast, 0);
+        cout << "=== 中间代码生成完成 ===" << endl;
+        generator.printQuadruples();
+    }
 };
 
 
+// ==================== 一遍翻译 ====================
+// 语法制导翻译：SLRParser每次移进、归约时直接生成四元式（见 SLRParser::translate），
+// 不构造AST，也不再遍历AST。if/while的条件用真假出口链（truelist/falselist），
+// 语句用后继链（nextlist），跳转目标确定后回填为目标四元式的序号。
+// 符号检查随归约进行，因此与语义分析器不同，变量和函数须先声明后使用。
+class OnePassTranslator {
+public:
+    // 形参或实参
+    struct Item {
+        string name;                // 形参名，实参为其值所在
+        DataType type;
+        bool isArray;
+    };
+    
+    // 文法符号的属性
+    struct Value {
+        TokenType token = TokenType::UNKNOWN;   // 终结符的记号类型，非终结符为UNKNOWN
+        string place;               // 终结符的文本；表达式的值所在：变量名、常量或临时变量
+        DataType type = DataType::UNKNOWN;
+        bool typeSpec = false;      // 是否为类型说明符Type
+        int line = 0;
+        int quad = 0;               // 该符号的代码从第几条四元式开始
+        vector<int> truelist, falselist, nextlist;
+        vector<Item> items;         // 形参表、实参表
+    };
+    
+    OnePassTranslator(IntermediateCodeGenerator& generator) : generator(generator) {}
+    
+    void bind(const vector<string>& signatures) {
+        static const map<string, Rule> rules = {
+            {"VarDecl -> Type ID SEMI", VAR_DECL},
+            {"VarDecl -> Type ID LBRACK INT_NUM RBRACK SEMI", ARRAY_DECL},
+            {"VarDecl -> Type ID ASG Expr SEMI", INIT_DECL},
+            {"Type -> INT", TYPE_INT},
+            {"Type -> FLOAT", TYPE_FLOAT},
+            {"Type -> VOID", TYPE_VOID},
+            {"FunDecl -> Type ID LPAR ParamList RPAR CompStmt", FUN_DECL},
+            {"ParamList -> ParamList COMMA Param", LIST_APPEND},
+            {"ParamList -> Param", LIST_FIRST},
+            {"Param -> Type ID", PARAM},
+            {"Param -> Type ID LBRACK RBRACK", ARRAY_PARAM},
+            {"CompStmt -> LBR StmtList RBR", COMP_STMT},
+            {"StmtList -> StmtList Stmt", STMT_APPEND},
+            {"IfStmt -> IF LPAR Expr RPAR CompStmt", IF},
+            {"IfStmt -> IF LPAR Expr RPAR CompStmt ELSE Stmt", IF_ELSE},
+            {"LoopStmt -> WHILE LPAR Expr RPAR Stmt", WHILE},
+            {"RetStmt -> RETURN Expr SEMI", RETURN_VALUE},
+            {"RetStmt -> RETURN SEMI", RETURN_VOID},
+            {"Expr -> ID ASG Expr", ASSIGN},
+            {"Expr -> ID LBRACK Expr RBRACK ASG Expr", ARRAY_ASSIGN},
+            {"Expr -> ID LPAR ArgList RPAR", CALL},
+            {"ArithExpr -> ArithExpr REL_OP ArithExpr", REL_OP},
+            {"ArithExpr -> ArithExpr ADD ArithExpr", ARITH},
+            {"ArithExpr -> ArithExpr MUL ArithExpr", ARITH},
+            {"ArithExpr -> ID", VARIABLE},
+            {"ArithExpr -> ID LBRACK Expr RBRACK", ARRAY_ACCESS},
+            {"ArithExpr -> LPAR Expr RPAR", PAREN},
+            {"ArgList -> ArgList COMMA Expr", ARG_APPEND},
+            {"ArgList -> Expr", ARG_FIRST},
+        };
+        productionRules.assign(signatures.size(), NONE);
+        for (size_t p = 0; p < signatures.size(); ++p) {
+            auto it = rules.find(signatures[p]);
+            if (it != rules.end()) productionRules[p] = it->second;
+        }
+    }
+    
+    // 移进时的动作相当于产生式中间的标记：函数头的左括号处生成函数标签，右括号处登记函数和形参；
+    // if/while条件后的右括号处生成条件跳转；else处生成跳过else部分的跳转；左花括号处进入作用域
+    void shift(const Token& token, StackSpan<Value> stack, Value& value) {
+        value.token = token.type;
+        value.place = token.value;
+        value.line = token.line;
+        value.quad = generator.nextQuad();
+        if (token.type == TokenType::INT_NUM) value.type = DataType::INT;
+        else if (token.type == TokenType::FLOAT_NUM) value.type = DataType::FLOAT;
+        
+        size_t n = stack.size();
+        switch (token.type) {
+            case TokenType::LPAR:
+                // Type ID . LPAR：函数定义开始
+                if (n >= 2 && stack[n - 1].token == TokenType::ID && stack[n - 2].typeSpec) {
+                    generator.generateLabel(stack[n - 1].place);
+                }
+                break;
+            case TokenType::RPAR:
+                if (n >= 3 && isConditionStart(stack, n - 1)) {
+                    condition(stack[n - 1]);
+                } else if (n >= 4 && stack[n - 2].token == TokenType::LPAR && stack[n - 3].token == TokenType::ID &&
+                           stack[n - 4].typeSpec) {
+                    beginFunction(stack[n - 4], stack[n - 3], stack[n - 1]);
+                }
+                break;
+            case TokenType::ELSE:
+                // IF LPAR Expr RPAR CompStmt . ELSE：then部分结束后跳过else部分，条件为假时转到else部分
+                if (n >= 5) {
+                    value.nextlist.push_back(generator.emitJump("jmp"));
+                    generator.backpatch(stack[n - 3].falselist, generator.nextQuad());
+                }
+                break;
+            case TokenType::ASG:
+                // Type ID . ASG：带初始化的变量声明，先登记变量再分析初始化表达式
+                if (n >= 2 && stack[n - 1].token == TokenType::ID && stack[n - 2].typeSpec) {
+                    declareVariable(stack[n - 1], stack[n - 2].type, false);
+                }
+                break;
+            case TokenType::LBR:
+                symbolTable.enterScope();
+                break;
+            default:
+                break;
+        }
+    }
+    
+    void reduce(int production, StackSpan<Value> below, StackSpan<Value> children, Value& result) {
+        result.quad = children.empty() ? generator.nextQuad() : children[0].quad;
+        result.line = children.empty() ? 0 : children[0].line;
+        Rule rule = productionRules[production];
+        switch (rule) {
+            case NONE:
+                // 单产生式原样传递属性，其余没有翻译动作
+                if (children.size() == 1) {
+                    result = move(children[0]);
+                    result.token = TokenType::UNKNOWN;
+                }
+                break;
+            case VAR_DECL:
+                declareVariable(children[1], children[0].type, false);
+                break;
+            case ARRAY_DECL:
+                declareVariable(children[1], children[0].type == DataType::INT ? DataType::ARRAY_INT : DataType::ARRAY_FLOAT, true);
+                break;
+            case INIT_DECL: {
+                // 变量已在ASG处登记
+                Value& init = children[3];
+                DataType varType = children[0].type;
+                if (init.type != DataType::UNKNOWN && init.type != varType) {
+                    error("变量 '" + children[1].place + "' 初始化类型不匹配", children[1].line);
+                }
+                generator.generateAssignment(children[1].place, init.place);
+                break;
+            }
+            case TYPE_INT:
+            case TYPE_FLOAT:
+            case TYPE_VOID:
+                result.typeSpec = true;
+                result.type = rule == TYPE_INT ? DataType::INT : rule == TYPE_FLOAT ? DataType::FLOAT : DataType::VOID;
+                break;
+            case FUN_DECL:
+                generator.backpatch(children[5].nextlist, generator.nextQuad());
+                symbolTable.exitScope();
+                break;
+            case LIST_APPEND:
+                result.items = move(children[0].items);
+                result.items.insert(result.items.end(), children[2].items.begin(), children[2].items.end());
+                break;
+            case LIST_FIRST:
+                result.items = move(children[0].items);
+                break;
+            case PARAM:
+            case ARRAY_PARAM: {
+                DataType type = children[0].type;
+                if (rule == ARRAY_PARAM) type = type == DataType::INT ? DataType::ARRAY_INT : DataType::ARRAY_FLOAT;
+                result.items.push_back({children[1].place, type, rule == ARRAY_PARAM});
+                result.line = children[1].line;
+                break;
+            }
+            case COMP_STMT:
+                result.nextlist = move(children[1].nextlist);
+                symbolTable.exitScope();
+                break;
+            case STMT_APPEND:
+                // StmtList -> StmtList M Stmt：前一条语句的后继就是这条语句的开始
+                generator.backpatch(children[0].nextlist, children[1].quad);
+                result.nextlist = move(children[1].nextlist);
+                break;
+            case IF:
+                result.nextlist = merge(children[2].falselist, children[4].nextlist);
+                break;
+            case IF_ELSE:
+                result.nextlist = merge(merge(children[4].nextlist, children[5].nextlist), children[6].nextlist);
+                break;
+            case WHILE: {
+                // WHILE LPAR M Expr RPAR Stmt：循环体的后继和末尾的跳转都回到条件的开始
+                int start = children[2].quad;
+                generator.backpatch(children[4].nextlist, start);
+                generator.emit("jmp", "", "", to_string(start));
+                result.nextlist = move(children[2].falselist);
+                break;
+            }
+            case RETURN_VALUE:
+                generator.generateReturn(children[1].place);
+                break;
+            case RETURN_VOID:
+                generator.generateReturn();
+                break;
+            case ASSIGN: {
+                DataType targetType = lookupVariable(children[0]);
+                if (targetType != DataType::UNKNOWN && children[2].type != DataType::UNKNOWN && targetType != children[2].type) {
+                    error("赋值类型不匹配", children[0].line);
+                }
+                generator.generateAssignment(children[0].place, children[2].place);
+                result.place = children[0].place;
+                result.type = targetType;
+                break;
+            }
+            case ARRAY_ASSIGN:
+                lookupVariable(children[0]);
+                generator.generateArrayAssignment(children[0].place, children[2].place, children[5].place);
+                result.place = children[0].place + "[" + children[2].place + "]";
+                break;
+            case CALL:
+                call(children[0], children[2].items, result);
+                break;
+            case REL_OP:
+                checkOperands(children[0], children[2]);
+                result.type = DataType::INT;
+                if (below.size() >= 2 && isConditionStart(below, below.size())) {
+                    // 整个条件就是这个关系表达式，直接生成真假出口
+                    result.truelist.push_back(generator.emitJump("j" + children[1].place, children[0].place, children[2].place));
+                    result.falselist.push_back(generator.emitJump("jmp"));
+                } else {
+                    result.place = generator.generateRelationalExpr(children[1].place, children[0].place, children[2].place);
+                }
+                break;
+            case ARITH:
+                checkOperands(children[0], children[2]);
+                result.type = children[0].type;
+                result.place = generator.generateArithmeticExpr(children[1].place, children[0].place, children[2].place);
+                break;
+            case VARIABLE:
+                result.place = children[0].place;
+                result.type = lookupVariable(children[0]);
+                break;
+            case ARRAY_ACCESS:
+                lookupVariable(children[0]);
+                result.place = generator.generateArrayAccess(children[0].place, children[2].place);
+                break;
+            case PAREN: {
+                int quad = result.quad;
+                result = move(children[1]);
+                result.quad = quad;
+                break;
+            }
+            case ARG_APPEND:
+                result.items = move(children[0].items);
+                result.items.push_back({children[2].place, children[2].type, false});
+                break;
+            case ARG_FIRST:
+                result.items.push_back({children[0].place, children[0].type, false});
+                break;
+        }
+    }
+    
+    void printErrors() const {
+        if (errors.empty()) {
+            cout << "\n语义分析完成，无错误。" << endl;
+        } else {
+            cout << "\n=== 语义错误 ===" << endl;
+            for (const auto& error : errors) error.print();
+        }
+    }
+    
+    size_t getErrorCount() const {
+        return errors.size();
+    }
+    
+private:
+    enum Rule {
+        NONE, VAR_DECL, ARRAY_DECL, INIT_DECL, TYPE_INT, TYPE_FLOAT, TYPE_VOID, FUN_DECL,
+        LIST_APPEND, LIST_FIRST, PARAM, ARRAY_PARAM, COMP_STMT, STMT_APPEND, IF, IF_ELSE, WHILE,
+        RETURN_VALUE, RETURN_VOID, ASSIGN, ARRAY_ASSIGN, CALL, REL_OP, ARITH, VARIABLE, ARRAY_ACCESS,
+        PAREN, ARG_APPEND, ARG_FIRST
+    };
+    
+    IntermediateCodeGenerator& generator;
+    SymbolTable symbolTable;
+    vector<SemanticError> errors;
+    vector<Rule> productionRules;   // 按产生式编号
+    
+    static vector<int> merge(vector<int> a, const vector<int>& b) {
+        a.insert(a.end(), b.begin(), b.end());
+        return a;
+    }
+    
+    // stack[0, end)的末尾是否为 IF LPAR 或 WHILE LPAR，即其后是if/while的条件
+    static bool isConditionStart(StackSpan<Value> stack, size_t end) {
+        if (end < 2 || stack[end - 1].token != TokenType::LPAR) return false;
+        TokenType keyword = stack[end - 2].token;
+        return keyword == TokenType::IF || keyword == TokenType::WHILE;
+    }
+    
+    // 条件表达式结束：关系表达式已生成真假出口，其他表达式按值是否为0跳转。
+    // 真出口就是紧接着的then部分或循环体
+    void condition(Value& expr) {
+        if (expr.truelist.empty() && expr.falselist.empty()) {
+            expr.falselist.push_back(generator.emitJump("jz", expr.place));
+        }
+        generator.backpatch(expr.truelist, generator.nextQuad());
+        expr.truelist.clear();
+    }
+    
+    // 函数头 Type ID LPAR ParamList RPAR 结束：登记函数，进入函数作用域并登记形参
+    void beginFunction(const Value& type, const Value& name, const Value& params) {
+        vector<DataType> paramTypes;
+        for (const auto& param : params.items) paramTypes.push_back(param.type);
+        if (!symbolTable.declareFunction(name.place, type.type, paramTypes)) {
+            error("函数 '" + name.place + "' 重复声明", name.line);
+        }
+        symbolTable.enterScope();
+        for (const auto& param : params.items) {
+            if (!symbolTable.declareVariable(param.name, param.type, param.isArray)) {
+                error("参数 '" + param.name + "' 重复声明", name.line);
+            }
+        }
+    }
+    
+    void declareVariable(const Value& name, DataType type, bool isArray) {
+        if (!symbolTable.declareVariable(name.place, type, isArray)) {
+            error("变量 '" + name.place + "' 重复声明", name.line);
+        }
+    }
+    
+    DataType lookupVariable(const Value& name) {
+        if (!symbolTable.isDeclared(name.place)) {
+            error("变量 '" + name.place + "' 未声明", name.line);
+            return DataType::UNKNOWN;
+        }
+        return symbolTable.getType(name.place);
+    }
+    
+    void checkOperands(const Value& left, const Value& right) {
+        if (left.type != DataType::UNKNOWN && right.type != DataType::UNKNOWN && left.type != right.type) {
+            error("二元操作类型不匹配", left.line);
+        }
+    }
+    
+    void call(const Value& name, const vector<Item>& args, Value& result) {
+        SymbolEntry* func = symbolTable.lookup(name.place);
+        if (!func || !func->isFunction) {
+            error("函数 '" + name.place + "' 未声明", name.line);
+        } else {
+            if (args.size() != func->paramTypes.size()) {
+                error("函数 '" + name.place + "' 参数个数不匹配", name.line);
+            }
+            for (size_t i = 0; i < min(args.size(), func->paramTypes.size()); i++) {
+                if (args[i].type != DataType::UNKNOWN && args[i].type != func->paramTypes[i]) {
+                    error("函数 '" + name.place + "' 第" + to_string(i + 1) + "个参数类型不匹配", name.line);
+                }
+            }
+            result.type = func->type;
+        }
+        vector<string> places;
+        for (const auto& arg : args) places.push_back(arg.name);
+        result.place = generator.generateFunctionCall(name.place, places);
+    }
+    
+    void error(const string& message, int line) {
+        errors.push_back(SemanticError(message, line, 1));
+    }
+};
+
 int main(int argc, char* argv[]) {
     // 处理命令行参数
     string inputFile = "";
+    string grammarFile = "";
+    string tableCacheDir = "";
+    bool lazyTable = false;
+    bool quiet = false;
+    bool syntaxOnly = false;
+    bool onePass = false;
+    bool flatAST = false;
+    bool emitASTJson = false;
+    bool hashCons = false;
+    int threadCount = 1;
     
     for (int i = 1; i < argc; i++) {
-        if (string(argv[i]) == "--debug" || string(argv[i]) == "-d") {
+        string arg = argv[i];
+        if (arg == "--debug" || arg == "-d") {
             DEBUG_MODE = true;
+        } else if (arg == "--grammar" && i + 1 < argc) {
+            grammarFile = argv[++i];
+        } else if (arg == "--table-cache" && i + 1 < argc) {
+            tableCacheDir = argv[++i];
+        } else if (arg == "--lazy-table") {
+            lazyTable = true;
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--syntax-only") {
+            syntaxOnly = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (arg == "--one-pass") {
+            onePass = true;
+        } else if (arg == "--flat-ast") {
+            flatAST = true;
+        } else if (arg == "--emit-ast-json") {
+            emitASTJson = true;
+        } else if (arg == "--hash-cons") {
+            hashCons = true;
         } else {
-            inputFile = argv[i];
+            inputFile = arg;
         }
     }
     
     if (inputFile.empty()) {
         cout << "用法: " << argv[0] << " [选项] <输入文件>" << endl;
         cout << "选项:" << endl;
-        cout << "  --debug, -d    启用调试模式" << endl;
+        cout << "  --debug, -d            启用调试模式" << endl;
+        cout << "  --grammar <文件>       使用自定义文法构造分析表" << endl;
+        cout << "  --table-cache <目录>   自定义文法的分析表缓存目录" << endl;
+        cout << "  --lazy-table           分析时按需构造分析表状态" << endl;
+        cout << "  --quiet                语法分析时不输出记号和AST" << endl;
+        cout << "  --syntax-only          只检查语法，不构造AST、不生成代码" << endl;
+        cout << "  --threads <N>          按顶层声明用N个线程并行语法分析（不输出记号和AST）" << endl;
+        cout << "  --one-pass             语法分析的同时生成四元式，不构造AST" << endl;
+        cout << "  --flat-ast             语义分析和中间代码生成在扁平AST上进行" << endl;
+        cout << "  --emit-ast-json        把AST写入ast.json" << endl;
+        cout << "  --hash-cons            合并结构相同的纯表达式，基本块内复用其临时变量" << endl;
         return 1;
     }
     
@@ -445,11 +1071,66 @@ int main(int argc, char* argv[]) {
         }
         
         // 创建语法分析器并解析文件
-        SLRParser parser;
-        parser.loadSLRTable();
+        SLRParser parser(true, grammarFile.empty() && !lazyTable);
+        parser.setErrorHandler(globalErrorHandler);
+        if (!grammarFile.empty()) {
+            vector<string> rules;
+            if (!read_grammar_rules(grammarFile, rules)) {
+                cerr << "无法打开文法文件: " << grammarFile << endl;
+                delete globalErrorHandler;
+                return 1;
+            }
+            if (lazyTable) {
+                parser.loadLazySLRTable(rules);
+            } else {
+                parser.loadSLRTable(rules, tableCacheDir);
+            }
+        } else if (lazyTable) {
+            parser.loadLazySLRTable();
+        }
+        
+        if (syntaxOnly) {
+            auto result = parser.validate(inputFile);
+            if (result.accepted) {
+                cout << inputFile << ": 语法正确" << endl;
+            } else {
+                cout << inputFile << ":" << result.line << ": 语法错误，意外的记号 '" << result.token << "'" << endl;
+            }
+            delete globalErrorHandler;
+            return result.accepted ? 0 : 1;
+        }
+        
+        if (onePass) {
+            // --one-pass：归约时直接做符号检查并生成四元式，跳转目标用回填确定
+            cout << "=== 开始一遍翻译 ===" << endl;
+            IntermediateCodeGenerator generator;
+            OnePassTranslator translator(generator);
+            if (!parser.translate(inputFile, translator)) {
+                globalErrorHandler->reportSyntaxError("语法分析失败，无法生成中间代码", inputFile);
+                globalErrorHandler->printAllErrors();
+                delete globalErrorHandler;
+                return 1;
+            }
+            translator.printErrors();
+            if (translator.getErrorCount() > 0) {
+                cout << "=== 由于存在编译错误，跳过中间代码生成 ===" << endl;
+                delete globalErrorHandler;
+                return 1;
+            }
+            generator.printQuadruples();
+            globalErrorHandler->printAllErrors();
+            cout << "\n=== 程序执行完成 ===" << endl;
+            delete globalErrorHandler;
+            return 0;
+        }
         
         cout << "=== 开始语法分析 ===" << endl;
-        shared_ptr<ASTNode> ast = parser.parse(inputFile);
+        shared_ptr<ASTNode> ast;
+        if (threadCount > 1) {
+            ast = parser.parseParallel(inputFile, threadCount);
+        } else {
+            ast = quiet ? parser.parseQuiet(inputFile) : parser.parse(inputFile);
+        }
         
         if (!ast) {
             globalErrorHandler->reportSyntaxError("语法分析失败，无法生成AST", inputFile);
@@ -458,16 +1139,26 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
+        if (emitASTJson) saveASTtoJSON(ast, "ast.json");
         cout << "=== 语法分析完成，AST生成成功 ===" << endl;
         
         // 语义分析
         cout << "=== 开始语义分析 ===" << endl;
         SemanticAnalyzer semanticAnalyzer;
         bool semanticSuccess = false;
+        // --hash-cons：合并结构相同的纯表达式，此后的语义分析和代码生成按节点缓存结果
+        if (hashCons) {
+            ExpressionTable table;
+            table.internTree(ast);
+            semanticAnalyzer.enableTypeCache();
+        }
+        // --flat-ast：转换为扁平AST，之后各遍都在其上进行
+        FlatAST flat;
+        if (flatAST) flat = FlatAST(ast);
         
         if (ast->type == NodeType::PROGRAM) {
             auto program = static_pointer_cast<ProgramNode>(ast);
-            semanticSuccess = semanticAnalyzer.analyzeProgram(program);
+            semanticSuccess = flatAST ? semanticAnalyzer.analyzeProgram(flat) : semanticAnalyzer.analyzeProgram(program);
         } else {
             globalErrorHandler->reportSemanticError("AST根节点不是程序节点", inputFile);
         }
@@ -501,9 +1192,14 @@ int main(int argc, char* argv[]) {
         // 创建中间代码生成器
         IntermediateCodeGenerator generator;
         ASTCodeGenerator astGenerator(generator);
+        if (hashCons) astGenerator.enableTempReuse();
         
         // 生成中间代码
-        astGenerator.generateProgramCode(ast);
+        if (flatAST) {
+            astGenerator.generateProgramCode(flat);
+        } else {
+            astGenerator.generateProgramCode(ast);
+        }
         
         // 打印最终的错误报告（包括警告）
         globalErrorHandler->printAllErrors();
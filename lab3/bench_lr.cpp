@@ -0,0 +1,231 @@
+// 分析表构造基准测试
+// 对内置文法rules0~rules6以及按规模生成的合成文法（表达式型、语句型、列表型，
+// 约100/1000/10000条产生式），分别测量读入文法、FIRST集、FOLLOW集、LR(0)项目集规范族、
+// SLR(1)分析表和压缩后的运行时分析表各阶段的用时与堆内存峰值，并给出状态数和项目数。
+// 用法: bench_lr [--max N] [--shape expr|stmt|list] [--builtin-only]
+#include "lr0.cpp"
+#include <cstdlib>
+#include <new>
+
+// ===== 堆内存统计 =====
+// 替换全局operator new/delete，在每块内存前记录其大小，
+// 以便统计当前占用和阶段内的峰值
+static size_t heap_current = 0;
+static size_t heap_peak = 0;
+
+static const size_t HEAP_HEADER = alignof(max_align_t);
+
+void* operator new(size_t size) {
+    char* p = (char*)malloc(size + HEAP_HEADER);
+    if (!p) throw bad_alloc();
+    *(size_t*)p = size;
+    heap_current += size;
+    if (heap_current > heap_peak) heap_peak = heap_current;
+    return p + HEAP_HEADER;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    char* p = (char*)((uintptr_t)ptr - HEAP_HEADER);
+    heap_current -= *(size_t*)p;
+    free(p);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+// ===== 合成文法 =====
+// 文法由若干互不相交的“块”组成，每块是一个小语言；顶层用k0~k7作前缀的
+// 8叉分派树选择块，使产生式总数可以线性放大而终结符数保持不变
+
+// 表达式型：六级左递归运算符优先级链，每块16条产生式
+static void expr_block(int b, vector<string>& rules) {
+    string n = to_string(b);
+    rules.push_back("E" + n + " -> E" + n + " or A" + n + " | A" + n);
+    rules.push_back("A" + n + " -> A" + n + " and R" + n + " | R" + n);
+    rules.push_back("R" + n + " -> P" + n + " rel P" + n + " | P" + n);
+    rules.push_back("P" + n + " -> P" + n + " add M" + n + " | M" + n);
+    rules.push_back("M" + n + " -> M" + n + " mul U" + n + " | U" + n);
+    rules.push_back("U" + n + " -> not U" + n + " | F" + n);
+    rules.push_back("F" + n + " -> id | num | ( E" + n + " ) | id ( E" + n + " )");
+}
+
+// 语句型：if/if-else/while/复合语句/赋值/return，带悬空else，每块15条产生式
+static void stmt_block(int b, vector<string>& rules) {
+    string n = to_string(b);
+    rules.push_back("S" + n + " -> if ( X" + n + " ) S" + n + " | if ( X" + n + " ) S" + n + " else S" + n +
+                    " | while ( X" + n + " ) S" + n + " | { L" + n + " } | id = X" + n + " ; | return X" + n + " ;");
+    rules.push_back("L" + n + " -> L" + n + " S" + n + " | ε");
+    rules.push_back("X" + n + " -> X" + n + " rel Y" + n + " | Y" + n);
+    rules.push_back("Y" + n + " -> Y" + n + " add Z" + n + " | Z" + n);
+    rules.push_back("Z" + n + " -> id | num | ( X" + n + " )");
+}
+
+// 列表型：可空的逗号列表、嵌套方括号/花括号列表和分号分隔的键值对，每块11条产生式
+static void list_block(int b, vector<string>& rules) {
+    string n = to_string(b);
+    rules.push_back("L" + n + " -> L" + n + " , I" + n + " | I" + n + " | ε");
+    rules.push_back("I" + n + " -> [ L" + n + " ] | { M" + n + " } | atom | I" + n + " : atom");
+    rules.push_back("M" + n + " -> M" + n + " ; P" + n + " | P" + n);
+    rules.push_back("P" + n + " -> atom = I" + n + " | atom");
+}
+
+struct Shape {
+    string name;
+    string block_start;   // 块开始符号的前缀
+    int block_size;       // 每块的产生式数
+    void (*block)(int, vector<string>&);
+};
+
+static const vector<Shape>& shapes() {
+    static const vector<Shape> all = {
+        {"expr", "E", 16, expr_block},
+        {"stmt", "S", 15, stmt_block},
+        {"list", "L", 11, list_block},
+    };
+    return all;
+}
+
+// 为blocks[lo, hi)建立分派树，返回子树的开始符号
+static string dispatch(const Shape& shape, int lo, int hi, int& next_id, vector<string>& rules) {
+    if (hi - lo == 1) return shape.block_start + to_string(lo);
+    int span = 1;
+    while (span * 8 < hi - lo) span *= 8;
+    string name = "D" + to_string(next_id++);
+    string rule = name + " ->";
+    for (int k = 0, i = lo; i < hi; ++k, i += span) {
+        if (k > 0) rule += " |";
+        rule += " k" + to_string(k) + " " + dispatch(shape, i, min(i + span, hi), next_id, rules);
+    }
+    rules.push_back(rule);
+    return name;
+}
+
+// 生成约target条产生式的文法
+static vector<string> synthetic_grammar(const Shape& shape, int target) {
+    // 分派树约占每块1.15条产生式，另加Prog的两条
+    int blocks = max(1, (int)((target - 2) / (shape.block_size + 1.15) + 0.5));
+    vector<string> rules;
+    vector<string> body;
+    int next_id = 0;
+    string root = dispatch(shape, 0, blocks, next_id, body);
+    rules.push_back("Prog -> Prog " + root + " | " + root);
+    rules.insert(rules.end(), body.begin(), body.end());
+    for (int b = 0; b < blocks; ++b) shape.block(b, rules);
+    return rules;
+}
+
+// ===== 测量 =====
+struct Phase {
+    double ms = 0;
+    size_t peak = 0;    // 阶段内堆内存峰值相对阶段开始时的增量
+};
+
+template <typename F>
+static Phase measure(F f) {
+    size_t base = heap_current;
+    heap_peak = heap_current;
+    auto t0 = chrono::steady_clock::now();
+    f();
+    auto t1 = chrono::steady_clock::now();
+    Phase p;
+    p.ms = chrono::duration<double, milli>(t1 - t0).count();
+    p.peak = heap_peak - base;
+    return p;
+}
+
+static string format_bytes(size_t bytes) {
+    ostringstream os;
+    os << fixed << setprecision(1);
+    if (bytes >= (1u << 20)) os << bytes / 1048576.0 << "M";
+    else os << bytes / 1024.0 << "K";
+    return os.str();
+}
+
+// 按显示宽度对齐（汉字占两列），setw按字节计数无法对齐中文表头
+static string pad(const string& s, int width, bool align_left = false) {
+    int shown = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = s[i];
+        if (c < 0x80) shown += 1;
+        else if (c >= 0xC0) shown += 2;
+    }
+    string fill(max(0, width - shown), ' ');
+    return align_left ? s + fill : fill + s;
+}
+
+static void print_header() {
+    cout << pad("文法", 14, true) << pad("产生式", 8) << pad("状态", 7) << pad("项目", 9) << pad("冲突", 6);
+    for (const char* name : {"读入", "FIRST", "FOLLOW", "项目集", "SLR表", "压缩表"}) {
+        cout << pad(name, 17);
+    }
+    cout << pad("合计ms", 10) << endl;
+}
+
+static void bench(const string& name, const vector<string>& rules) {
+    Grammar g;
+    CanonicalCollection cc;
+    SLRTable table;
+    Phase phases[6];
+    phases[0] = measure([&] { g.parse(rules); });
+    phases[1] = measure([&] { g.compute_first(); });
+    phases[2] = measure([&] { g.compute_follow(); });
+    phases[3] = measure([&] { cc = build_canonical_collection(g); });
+    phases[4] = measure([&] { table = build_slr_table(g, cc); });
+    phases[5] = measure([&] {
+        ParseTable pt = build_parse_table(g, table, cc.C.size());
+        pt.compress();
+    });
+
+    size_t items = 0;
+    for (const auto& I : cc.C) items += I.items.size();
+    double total = 0;
+    cout << pad(name, 14, true) << pad(to_string(g.productions.size()), 8) << pad(to_string(cc.C.size()), 7)
+         << pad(to_string(items), 9) << pad(to_string(table.conflicts.size()), 6);
+    for (const auto& p : phases) {
+        ostringstream cell;
+        cell << fixed << setprecision(2) << p.ms << "ms/" << format_bytes(p.peak);
+        cout << pad(cell.str(), 17);
+        total += p.ms;
+    }
+    ostringstream sum;
+    sum << fixed << setprecision(2) << total;
+    cout << pad(sum.str(), 10) << endl;
+}
+
+int main(int argc, char* argv[]) {
+    int max_productions = 10000;
+    string only_shape;
+    bool builtin_only = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--max" && i + 1 < argc) {
+            max_productions = atoi(argv[++i]);
+        } else if (arg == "--shape" && i + 1 < argc) {
+            only_shape = argv[++i];
+        } else if (arg == "--builtin-only") {
+            builtin_only = true;
+        } else {
+            cerr << "用法: " << argv[0] << " [--max N] [--shape expr|stmt|list] [--builtin-only]" << endl;
+            return 1;
+        }
+    }
+
+    cout << "=== 分析表构造基准（每格为 用时/堆内存峰值增量）===" << endl;
+    print_header();
+    vector<vector<string>> builtin = builtin_grammars();
+    for (size_t i = 0; i < builtin.size(); ++i) {
+        bench("rules" + to_string(i), builtin[i]);
+    }
+    if (builtin_only) return 0;
+
+    for (const auto& shape : shapes()) {
+        if (!only_shape.empty() && shape.name != only_shape) continue;
+        for (int size : {100, 1000, 10000}) {
+            if (size > max_productions) break;
+            bench(shape.name + "-" + to_string(size), synthetic_grammar(shape, size));
+        }
+    }
+    return 0;
+}
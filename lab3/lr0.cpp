@@ -8,6 +8,24 @@
 #include <queue>
 #include <iomanip>
 #include <tuple>
+#include <cstdint>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <climits>
+#include <chrono>
+#include <stdexcept>
+#include <cerrno>
 
 using namespace std;
 
@@ -20,6 +38,17 @@ struct Production {
     vector<string> right;
 };
 
+// 产生式签名，如 "Expr -> ID ASG Expr"、"ArgList -> ε"，用于按产生式内容而非编号绑定语义动作
+string production_signature(const Production& prod) {
+    string text = prod.left + " ->";
+    for (const auto& sym : prod.right) text += " " + sym;
+    if (prod.right.empty()) text += " ε";
+    return text;
+}
+
+// LR(0)项目把产生式编号和点的位置各打包为16位（见 Item），超出时项目会互相混淆
+const size_t ITEM_MAX_PRODUCTIONS = 1 << 16;
+const size_t ITEM_MAX_RHS_LENGTH = 0xFFFF;
 
 // 文法
 class Grammar {
@@ -31,9 +60,25 @@ public:
     map<string, set<string>> first;
     map<string, set<string>> follow;
 
+    // 符号编号索引（parse时建立）：非终结符按字典序在前，终结符按字典序在后
+    vector<string> symbols;
+    map<string, int> symbol_id;
+    int nonterminal_count = 0;
+    vector<vector<int>> rhs_ids;          // 产生式右部各符号的编号
+    vector<vector<int>> nt_productions;   // 非终结符编号 -> 以其为左部的产生式编号
+
+    // 优先级与结合性（yacc风格）：%left/%right/%nonassoc 每行一级，后声明的级别更高
+    map<string, int> token_prec;
+    map<string, char> token_assoc;        // 'l' 左结合, 'r' 右结合, 'n' 不可结合
+    vector<int> production_prec;          // 产生式优先级，0 表示未声明
+
     void parse(const vector<string>& rules);
+    void build_index();
     void compute_first();
     void compute_follow();
+    // 只重新计算only中非终结符的FIRST/FOLLOW集，其余沿用当前值（增量重建用）
+    void first_fixpoint(const set<string>* only);
+    void follow_fixpoint(const set<string>* only);
     void print_grammar();
     bool compute_first_of_string(const vector<string>& str, set<string>& result);
 };
@@ -42,7 +87,24 @@ void Grammar::parse(const vector<string>& rules) {
     productions.clear();
     nonterminals.clear();
     terminals.clear();
+    token_prec.clear();
+    token_assoc.clear();
+    vector<string> prec_tokens;  // 各产生式 %prec 指定的符号
+    int prec_level = 0;
     for (const auto& rule : rules) {
+        if (!rule.empty() && rule[0] == '%') {
+            stringstream ss(rule);
+            string kw, sym;
+            ss >> kw;
+            char assoc = kw == "%left" ? 'l' : kw == "%right" ? 'r' : kw == "%nonassoc" ? 'n' : 0;
+            if (assoc == 0) continue;
+            ++prec_level;
+            while (ss >> sym) {
+                token_prec[sym] = prec_level;
+                token_assoc[sym] = assoc;
+            }
+            continue;
+        }
         size_t arrow = rule.find("→");
         if (arrow == string::npos) arrow = rule.find("->");
         if (arrow == string::npos) continue;
@@ -55,13 +117,16 @@ void Grammar::parse(const vector<string>& rules) {
         while (getline(ss, prod, '|')) {
             vector<string> symbols;
             stringstream ssp(prod);
-            string sym;
+            string sym, prec_token;
             while (ssp >> sym) {
-                if (sym != "ε") {  // 跳过ε符号，让空产生式的right为空数组
+                if (sym == "%prec") {  // A → α %prec X：按X的优先级
+                    ssp >> prec_token;
+                } else if (sym != "ε") {  // 跳过ε符号，让空产生式的right为空数组
                     symbols.push_back(sym);
                 }
             }
             productions.push_back({left, symbols});
+            prec_tokens.push_back(prec_token);
         }
     }
     // 统计终结符
@@ -80,8 +145,53 @@ void Grammar::parse(const vector<string>& rules) {
     //string new_start = start_symbol + "'";
     string new_start = "S'";
     productions.insert(productions.begin(), {new_start, {start_symbol}});
+    prec_tokens.insert(prec_tokens.begin(), "");
     nonterminals.insert(new_start);
     start_symbol = new_start;
+
+    if (productions.size() > ITEM_MAX_PRODUCTIONS) {
+        throw length_error("产生式数 " + to_string(productions.size()) + " 超过上限 " +
+                           to_string(ITEM_MAX_PRODUCTIONS));
+    }
+    for (const auto& prod : productions) {
+        if (prod.right.size() > ITEM_MAX_RHS_LENGTH) {
+            throw length_error("产生式 " + prod.left + " 的右部长度 " + to_string(prod.right.size()) +
+                               " 超过上限 " + to_string(ITEM_MAX_RHS_LENGTH));
+        }
+    }
+
+    // 产生式优先级：有 %prec 时取指定符号的，否则取右部最后一个声明过优先级的终结符的
+    production_prec.assign(productions.size(), 0);
+    for (size_t p = 0; p < productions.size(); ++p) {
+        if (!prec_tokens[p].empty()) {
+            auto it = token_prec.find(prec_tokens[p]);
+            if (it != token_prec.end()) production_prec[p] = it->second;
+            continue;
+        }
+        for (const auto& sym : productions[p].right) {
+            auto it = token_prec.find(sym);
+            if (terminals.count(sym) && it != token_prec.end()) production_prec[p] = it->second;
+        }
+    }
+
+    build_index();
+}
+
+// 为符号和产生式建立整数编号，项目集构造时不再做字符串比较
+void Grammar::build_index() {
+    symbols.clear();
+    symbol_id.clear();
+    symbols.insert(symbols.end(), nonterminals.begin(), nonterminals.end());
+    symbols.insert(symbols.end(), terminals.begin(), terminals.end());
+    nonterminal_count = nonterminals.size();
+    for (size_t i = 0; i < symbols.size(); ++i) symbol_id[symbols[i]] = i;
+
+    rhs_ids.assign(productions.size(), {});
+    nt_productions.assign(nonterminal_count, {});
+    for (size_t p = 0; p < productions.size(); ++p) {
+        for (const auto& sym : productions[p].right) rhs_ids[p].push_back(symbol_id.at(sym));
+        nt_productions[symbol_id.at(productions[p].left)].push_back(p);
+    }
 }
 void Grammar::compute_first() {
     // 初始化：终结符的FIRST集就是它自身
@@ -91,13 +201,35 @@ void Grammar::compute_first() {
     // 初始化：所有非终结符的FIRST集为空集
     for (const auto& nt : nonterminals) first[nt] = {};
     
-    // 使用固定点算法计算FIRST集，直到没有任何变化
+    first_fixpoint(nullptr);
+    
+    // 输出FIRST集，方便调试
+    if (DEBUG_MODE) {
+        cout << "=== FIRST集 ===" << endl;
+        for (const auto& nt : nonterminals) {
+            cout << "FIRST(" << nt << ") = { ";
+            for (const auto& f : first[nt]) cout << f << ' ';
+            cout << "}" << endl;
+        }
+        
+        // 也输出终结符的FIRST集
+        for (const auto& t : terminals) {
+            cout << "FIRST(" << t << ") = { ";
+            for (const auto& f : first[t]) cout << f << ' ';
+            cout << "}" << endl;
+        }
+    }
+}
+
+// 使用固定点算法计算FIRST集，直到没有任何变化；only非空时只更新其中的非终结符
+void Grammar::first_fixpoint(const set<string>* only) {
     bool changed = true;
     while (changed) {
         changed = false;
         // 遍历所有产生式
         for (const auto& prod : productions) {
             string A = prod.left;
+            if (only && !only->count(A)) continue;
             const vector<string>& alpha = prod.right;
             
             // 处理空产生式: A → ε
@@ -136,23 +268,6 @@ void Grammar::compute_first() {
             }
         }
     }
-    
-    // 输出FIRST集，方便调试
-    if (DEBUG_MODE) {
-        cout << "=== FIRST集 ===" << endl;
-        for (const auto& nt : nonterminals) {
-            cout << "FIRST(" << nt << ") = { ";
-            for (const auto& f : first[nt]) cout << f << ' ';
-            cout << "}" << endl;
-        }
-        
-        // 也输出终结符的FIRST集
-        for (const auto& t : terminals) {
-            cout << "FIRST(" << t << ") = { ";
-            for (const auto& f : first[t]) cout << f << ' ';
-            cout << "}" << endl;
-        }
-    }
 }
 
 void Grammar::compute_follow() {
@@ -162,6 +277,20 @@ void Grammar::compute_follow() {
     // 规则1：将输入结束符#加入FOLLOW(S)，其中S是文法的开始符号
     follow[start_symbol].insert("#");
     
+    follow_fixpoint(nullptr);
+    
+    if (DEBUG_MODE) {
+        cout << "=== FOLLOW集 ===" << endl;
+        for (const auto& nt : nonterminals) {
+            cout << "FOLLOW(" << nt << ") = { ";
+            for (const auto& f : follow[nt]) cout << f << ' ';
+            cout << "}" << endl;
+        }
+    }
+}
+
+// 使用固定点算法计算FOLLOW集；only非空时只更新其中的非终结符
+void Grammar::follow_fixpoint(const set<string>* only) {
     bool changed = true;
     // 使用固定点算法计算FOLLOW集，直到没有任何变化
     while (changed) {
@@ -174,7 +303,7 @@ void Grammar::compute_follow() {
             for (size_t i = 0; i < prod.right.size(); ++i) {
                 const string& B = prod.right[i];
                 // 只处理非终结符
-                if (nonterminals.count(B)) {
+                if (nonterminals.count(B) && (!only || only->count(B))) {
                     // 规则2：对于产生式A→αBβ，将FIRST(β)中除ε外的所有符号加入FOLLOW(B)
                     if (i + 1 < prod.right.size()) {
                         // 构建β
@@ -212,15 +341,6 @@ void Grammar::compute_follow() {
             }
         }
     }
-    
-    if (DEBUG_MODE) {
-        cout << "=== FOLLOW集 ===" << endl;
-        for (const auto& nt : nonterminals) {
-            cout << "FOLLOW(" << nt << ") = { ";
-            for (const auto& f : follow[nt]) cout << f << ' ';
-            cout << "}" << endl;
-        }
-    }
 }
 
 // 计算字符串的FIRST集
@@ -258,6 +378,20 @@ bool Grammar::compute_first_of_string(const vector<string>& str, set<string>& re
     return all_nullable;
 }
 
+// 从文件读取文法规则，每行一条，忽略空行和以//开头的注释行
+bool read_grammar_rules(const string& filename, vector<string>& rules) {
+    ifstream file(filename);
+    if (!file) return false;
+    string line;
+    while (getline(file, line)) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == string::npos || line.compare(begin, 2, "//") == 0) continue;
+        size_t end = line.find_last_not_of(" \t\r");
+        rules.push_back(line.substr(begin, end - begin + 1));
+    }
+    return true;
+}
+
 void Grammar::print_grammar() {
     cout << "=== 产生式列表 ===" << endl;
     for (size_t i = 0; i < productions.size(); ++i) {
@@ -284,26 +418,28 @@ void Grammar::print_grammar() {
 }
 
 
-// LR(0)项目
+// LR(0)项目：打包为32位整数，高16位为产生式编号，低16位为点的位置（范围由 Grammar::parse 检查）
+// 按整数比较即等价于按(产生式编号, 点位置)的字典序比较
 struct Item {
-    int production_id; // 产生式编号
-    int dot_pos;       // 点的位置
-    
-    bool operator<(const Item& other) const {
-        return tie(production_id, dot_pos) < tie(other.production_id, other.dot_pos);
-    }
-    
-    bool operator==(const Item& other) const {
-        return production_id == other.production_id && dot_pos == other.dot_pos;
-    }
+    uint32_t code;
+
+    Item() : code(0) {}
+    Item(int production_id, int dot_pos) : code(((uint32_t)production_id << 16) | (uint32_t)dot_pos) {}
+
+    int production_id() const { return (int)(code >> 16); }
+    int dot_pos() const { return (int)(code & 0xFFFF); }
+    Item advance() const { Item next; next.code = code + 1; return next; }
+
+    bool operator<(const Item& other) const { return code < other.code; }
+    bool operator==(const Item& other) const { return code == other.code; }
+    bool operator!=(const Item& other) const { return code != other.code; }
 };
 
-// 项目集
+// 项目集：有序、无重复的连续数组
 struct ItemSet {
-    set<Item> items;
+    vector<Item> items;
     
     bool operator<(const ItemSet& other) const {
-        // 简化为直接比较两个set
         return items < other.items;
     }
     
@@ -311,80 +447,72 @@ struct ItemSet {
         return items == other.items;
     }
 
-    void print_itemset(const Grammar& g, int idx) {
+    void print_itemset(const Grammar& g, int idx) const {
         cout << "项目集I" << idx << "内容:" << endl;
         for (const auto& item : items) {
-            const auto& prod = g.productions[item.production_id];
+            const auto& prod = g.productions[item.production_id()];
             cout << "  " << prod.left << " → ";
             for (int j = 0; j < (int)prod.right.size(); ++j) {
-                if (j == item.dot_pos) cout << ". ";
+                if (j == item.dot_pos()) cout << ". ";
                 cout << prod.right[j] << ' ';
             }
-            if (item.dot_pos == (int)prod.right.size()) cout << ".";
-            cout << " [" << item.production_id << "," << item.dot_pos << "]" << endl;
+            if (item.dot_pos() == (int)prod.right.size()) cout << ".";
+            cout << " [" << item.production_id() << "," << item.dot_pos() << "]" << endl;
         }
     }
 };
 
-// 计算闭包
-ItemSet closure(const ItemSet& I, const Grammar& g) {
-    ItemSet result = I;
-    queue<Item> q;
-    for (const auto& item : I.items) q.push(item);
-
-    while (!q.empty()) {
-        Item item = q.front(); q.pop();
-        if (item.dot_pos >= (int)g.productions[item.production_id].right.size()) continue;
-        string B = g.productions[item.production_id].right[item.dot_pos];
-        if (g.nonterminals.count(B)) {
-            for (size_t i = 0; i < g.productions.size(); ++i) {
-                if (g.productions[i].left == B) {
-                    Item new_item = {(int)i, 0};
-                    if (result.items.insert(new_item).second) {
-                        q.push(new_item);
-                    }
-                }
-            }
+// 计算闭包：kernel须为有序项目序列
+// 闭包新增的项目点都在最左侧，因此只需记录哪些非终结符已经展开过
+ItemSet closure(const vector<Item>& kernel, const Grammar& g) {
+    static thread_local vector<unsigned> expanded;
+    static thread_local unsigned epoch = 0;
+    if (expanded.size() < (size_t)g.nonterminal_count) expanded.assign(g.nonterminal_count, 0);
+    if (++epoch == 0) {
+        fill(expanded.begin(), expanded.end(), 0);
+        epoch = 1;
+    }
+
+    ItemSet result;
+    result.items = kernel;
+    for (size_t k = 0; k < result.items.size(); ++k) {
+        Item item = result.items[k];
+        const vector<int>& rhs = g.rhs_ids[item.production_id()];
+        if (item.dot_pos() >= (int)rhs.size()) continue;
+        int B = rhs[item.dot_pos()];
+        if (B >= g.nonterminal_count || expanded[B] == epoch) continue;
+        expanded[B] = epoch;
+        for (int p : g.nt_productions[B]) {
+            result.items.push_back(Item(p, 0));
         }
     }
+    sort(result.items.begin(), result.items.end());
+    result.items.erase(unique(result.items.begin(), result.items.end()), result.items.end());
     return result;
 }
 
+ItemSet closure(const ItemSet& I, const Grammar& g) {
+    return closure(I.items, g);
+}
+
 // Goto函数
 ItemSet Goto(const ItemSet& I, const string& X, const Grammar& g) {
-    ItemSet goto_set;
+    vector<Item> kernel;
+    auto sym = g.symbol_id.find(X);
     
     if (DEBUG_MODE) {
         cout << "  调试Goto - 对于符号 " << X << ":" << endl;
     }
 
     for (const auto& item : I.items) {
-        const auto& prod = g.productions[item.production_id];
-        
-        if (DEBUG_MODE) {
-            cout << "    检查项目: " << prod.left << " → ";
-            for (int j = 0; j < (int)prod.right.size(); ++j) {
-                if (j == item.dot_pos) cout << ". ";
-                cout << prod.right[j] << ' ';
-            }
-            if (item.dot_pos == (int)prod.right.size()) cout << ".";
-            
-            bool condition1 = item.dot_pos < (int)prod.right.size();
-            string right_of_dot = condition1 ? prod.right[item.dot_pos] : "END";
-            bool condition2 = condition1 && right_of_dot == X;
-            
-            cout << " - 点位置: " << item.dot_pos << ", 产生式长度: " << prod.right.size();
-            cout << ", 点后符号: " << (condition1 ? right_of_dot : "无") << ", 匹配: " << (condition2 ? "是" : "否") << endl;
-        }
-        
-        bool has_next = item.dot_pos < (int)prod.right.size();
-        if (has_next && prod.right[item.dot_pos] == X) {
-            Item moved = {item.production_id, item.dot_pos + 1};
-            goto_set.items.insert(moved);
+        const vector<int>& rhs = g.rhs_ids[item.production_id()];
+        bool has_next = item.dot_pos() < (int)rhs.size();
+        if (has_next && sym != g.symbol_id.end() && rhs[item.dot_pos()] == sym->second) {
+            kernel.push_back(item.advance());
         }
     }
     
-    ItemSet result = closure(goto_set, g);
+    ItemSet result = closure(kernel, g);
     
     if (DEBUG_MODE) {
         cout << "  Goto结果项目集包含 " << result.items.size() << " 个项目" << endl;
@@ -399,78 +527,262 @@ struct CanonicalCollection {
     map<pair<int, string>, int> transitions; // (状态编号, 符号) -> 新状态编号
 };
 
+// 按点后符号对项目集分组，得到各符号的GOTO内核
+// 返回值按符号编号升序排列（非终结符在前，终结符在后），每个内核内部保持有序
+vector<pair<int, vector<Item>>> goto_kernels(const ItemSet& I, const Grammar& g) {
+    vector<pair<int, Item>> moves;
+    for (const auto& item : I.items) {
+        const vector<int>& rhs = g.rhs_ids[item.production_id()];
+        if (item.dot_pos() < (int)rhs.size()) {
+            moves.push_back({rhs[item.dot_pos()], item.advance()});
+        }
+    }
+    stable_sort(moves.begin(), moves.end(),
+                [](const pair<int, Item>& a, const pair<int, Item>& b) { return a.first < b.first; });
+
+    vector<pair<int, vector<Item>>> kernels;
+    for (const auto& mv : moves) {
+        if (kernels.empty() || kernels.back().first != mv.first) {
+            kernels.push_back({mv.first, {}});
+        }
+        kernels.back().second.push_back(mv.second);
+    }
+    return kernels;
+}
+
 CanonicalCollection build_canonical_collection(const Grammar& g) {
     CanonicalCollection cc;
-    vector<ItemSet> C;
-    map<ItemSet, int> set_id;
-    queue<int> q;
+    vector<ItemSet>& C = cc.C;
+    map<vector<Item>, int> kernel_id;  // 内核 -> 状态编号，闭包由内核唯一确定
 
     // 初始项目集
-    ItemSet I0;
-    I0.items.insert({0, 0});
-    I0 = closure(I0, g);
-    C.push_back(I0);
-    set_id[I0] = 0;
-    //I0.print_itemset(g, 0);
-
-    q.push(0);
-    while (!q.empty()) {
-        int idx = q.front(); q.pop();
-        ItemSet I = C[idx]; // 使用拷贝而非引用
-        
+    vector<Item> kernel0 = {Item(0, 0)};
+    C.push_back(closure(kernel0, g));
+    kernel_id[kernel0] = 0;
+
+    // 新状态总是追加在末尾，按编号顺序处理即为FIFO队列顺序
+    for (size_t idx = 0; idx < C.size(); ++idx) {
         if (DEBUG_MODE) {
+            const ItemSet& I = C[idx];
             cout << "处理状态 I" << idx << ":" << endl;
             cout << "  状态 I" << idx << " 项目集包含 " << I.items.size() << " 个项目" << endl;
             
             // 打印项目集内容
             for (const auto& item : I.items) {
-                const auto& prod = g.productions[item.production_id];
+                const auto& prod = g.productions[item.production_id()];
                 cout << "    项目: " << prod.left << " → ";
                 for (int j = 0; j < (int)prod.right.size(); ++j) {
-                    if (j == item.dot_pos) cout << ". ";
+                    if (j == item.dot_pos()) cout << ". ";
                     cout << prod.right[j] << ' ';
                 }
-                if (item.dot_pos == (int)prod.right.size()) cout << ".";
+                if (item.dot_pos() == (int)prod.right.size()) cout << ".";
                 cout << endl;
             }
         }
 
-        // 对所有符号计算GOTO
-        vector<string> symbols(g.nonterminals.begin(), g.nonterminals.end());
-        symbols.insert(symbols.end(), g.terminals.begin(), g.terminals.end());
-        for (const auto& X : symbols) {
-            ItemSet gotoI = Goto(I, X, g);
-            if (!gotoI.items.empty()) {
-                // 查找是否已存在相同的项目集
-                int target_id = -1;
-                for (size_t i = 0; i < C.size(); i++) {
-                    if (C[i].items == gotoI.items) {
-                        target_id = i;
-                        break;
-                    }
+        // 先算出全部GOTO内核，再追加新状态，避免C扩容使引用失效
+        vector<pair<int, vector<Item>>> kernels = goto_kernels(C[idx], g);
+        for (auto& k : kernels) {
+            const string& X = g.symbols[k.first];
+            auto found = kernel_id.find(k.second);
+            int target_id;
+            if (found == kernel_id.end()) {
+                // 新项目集
+                target_id = C.size();
+                C.push_back(closure(k.second, g));
+                kernel_id.emplace(move(k.second), target_id);
+                if (DEBUG_MODE) {
+                    cout << "  添加新状态 I" << target_id << " 来自 GOTO(I" << idx << ", " << X << ")" << endl;
                 }
-                
-                if (target_id == -1) {
-                    // 新项目集
-                    target_id = C.size();
-                    C.push_back(gotoI);
-                    set_id[gotoI] = target_id;
-                    q.push(target_id);
-                    if (DEBUG_MODE) {
-                        cout << "  添加新状态 I" << target_id << " 来自 GOTO(I" << idx << ", " << X << ")" << endl;
-                    }
-                } else {
-                    if (DEBUG_MODE) {
-                        cout << "  已存在状态 I" << target_id << " 来自 GOTO(I" << idx << ", " << X << ")" << endl;
-                    }
+            } else {
+                target_id = found->second;
+                if (DEBUG_MODE) {
+                    cout << "  已存在状态 I" << target_id << " 来自 GOTO(I" << idx << ", " << X << ")" << endl;
                 }
-                
-                cc.transitions[{idx, X}] = target_id;
             }
+            
+            cc.transitions[{(int)idx, X}] = target_id;
+        }
+    }
+    return cc;
+}
+
+
+// ===== 并行构造项目集规范族 =====
+// 简单的线程池：run(n, fn)把fn(0..n-1)分给各工作线程并等待全部完成
+class ThreadPool {
+public:
+    explicit ThreadPool(int thread_count) {
+        for (int i = 0; i < thread_count; ++i) {
+            workers.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    void run(int task_count, const function<void(int)>& fn) {
+        if (task_count <= 0) return;
+        unique_lock<mutex> lock(m);
+        job = &fn;
+        total = task_count;
+        next_task = 0;
+        finished = 0;
+        ++generation;
+        wake.notify_all();
+        done.wait(lock, [this] { return finished == total; });
+        job = nullptr;
+    }
+
+private:
+    vector<thread> workers;
+    mutex m;
+    condition_variable wake, done;
+    const function<void(int)>* job = nullptr;
+    int total = 0;
+    int next_task = 0;
+    int finished = 0;
+    unsigned generation = 0;
+    bool stopping = false;
+
+    void work() {
+        unsigned seen = 0;
+        unique_lock<mutex> lock(m);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || (generation != seen && job && next_task < total); });
+            if (stopping) return;
+            // 一次领取一小批任务，减少锁竞争
+            while (job && next_task < total) {
+                int begin = next_task;
+                int end = min(total, begin + 16);
+                next_task = end;
+                const function<void(int)>* fn = job;
+                lock.unlock();
+                for (int i = begin; i < end; ++i) (*fn)(i);
+                lock.lock();
+                finished += end - begin;
+                if (finished == total) done.notify_all();
+            }
+            seen = generation;
+        }
+    }
+};
+
+struct KernelHash {
+    size_t operator()(const vector<Item>& kernel) const {
+        uint64_t h = 1469598103934665603ULL;
+        for (const auto& item : kernel) {
+            h ^= item.code;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+};
+
+// 分片加锁的并发哈希表：内核 -> 临时状态编号
+class ConcurrentKernelTable {
+public:
+    ConcurrentKernelTable() : shards(64) {}
+
+    // 返回内核对应的编号；若是新内核则分配编号并返回true
+    bool intern(const vector<Item>& kernel, int& id) {
+        Shard& shard = shards[KernelHash()(kernel) % shards.size()];
+        lock_guard<mutex> lock(shard.m);
+        auto found = shard.ids.find(kernel);
+        if (found != shard.ids.end()) {
+            id = found->second;
+            return false;
+        }
+        id = next_id++;
+        shard.ids.emplace(kernel, id);
+        return true;
+    }
+
+    int size() const { return next_id; }
+
+private:
+    struct Shard {
+        mutex m;
+        unordered_map<vector<Item>, int, KernelHash> ids;
+    };
+    vector<Shard> shards;
+    atomic<int> next_id{0};
+};
+
+// 按BFS层并行扩展：同一层各状态的闭包与GOTO计算互不依赖，分给线程池处理；
+// 全部构造完后再按顺序算法的BFS顺序重新编号，保证输出与串行版本完全一致
+CanonicalCollection build_canonical_collection_parallel(const Grammar& g, int thread_count) {
+    if (thread_count <= 1) return build_canonical_collection(g);
+
+    ConcurrentKernelTable table;
+    vector<vector<Item>> kernels;                    // 临时编号 -> 内核
+    vector<ItemSet> states;                          // 临时编号 -> 闭包
+    vector<vector<pair<int, int>>> edges;            // 临时编号 -> (符号编号, 目标临时编号)，按符号升序
+
+    vector<Item> kernel0 = {Item(0, 0)};
+    int id0;
+    table.intern(kernel0, id0);
+    kernels.push_back(kernel0);
+
+    ThreadPool pool(thread_count);
+    vector<int> frontier = {id0};
+    while (!frontier.empty()) {
+        states.resize(kernels.size());
+        edges.resize(kernels.size());
+        vector<vector<pair<int, vector<Item>>>> discovered(frontier.size());
+
+        pool.run(frontier.size(), [&](int k) {
+            int id = frontier[k];
+            states[id] = closure(kernels[id], g);
+            for (auto& gk : goto_kernels(states[id], g)) {
+                int target;
+                if (table.intern(gk.second, target)) {
+                    discovered[k].push_back({target, move(gk.second)});
+                }
+                edges[id].push_back({gk.first, target});
+            }
+        });
+
+        // 本层新发现的内核组成下一层
+        kernels.resize(table.size());
+        vector<int> next;
+        for (auto& list : discovered) {
+            for (auto& d : list) {
+                kernels[d.first] = move(d.second);
+                next.push_back(d.first);
+            }
+        }
+        frontier.swap(next);
+    }
+
+    // 确定性重新编号：从初始状态出发按符号顺序BFS
+    vector<int> renumber(states.size(), -1);
+    vector<int> order = {id0};
+    renumber[id0] = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (const auto& e : edges[order[i]]) {
+            if (renumber[e.second] == -1) {
+                renumber[e.second] = order.size();
+                order.push_back(e.second);
+            }
+        }
+    }
+
+    CanonicalCollection cc;
+    cc.C.reserve(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        int id = order[i];
+        cc.C.push_back(move(states[id]));
+        for (const auto& e : edges[id]) {
+            cc.transitions[{(int)i, g.symbols[e.first]}] = renumber[e.second];
         }
-        
     }
-    cc.C = C;
     return cc;
 }
 
@@ -483,7 +795,7 @@ void print_canonical_collection(const CanonicalCollection& cc, const Grammar& g)
         // 内核项：点不在最左侧，或是初始项目集的S'→·S
         vector<Item> kernel, closure_items;
         for (const auto& item : cc.C[i].items) {
-            if (item.dot_pos > 0 || (item.production_id == 0 && item.dot_pos == 0)) {
+            if (item.dot_pos() > 0 || (item.production_id() == 0 && item.dot_pos() == 0)) {
                 kernel.push_back(item);
             } else {
                 closure_items.push_back(item);
@@ -491,24 +803,24 @@ void print_canonical_collection(const CanonicalCollection& cc, const Grammar& g)
         }
         cout << "  [内核项]" << endl;
         for (const auto& item : kernel) {
-            const auto& prod = g.productions[item.production_id];
+            const auto& prod = g.productions[item.production_id()];
             cout << "    " << prod.left << " → ";
             for (int j = 0; j < (int)prod.right.size(); ++j) {
-                if (j == item.dot_pos) cout << ". ";
+                if (j == item.dot_pos()) cout << ". ";
                 cout << prod.right[j] << ' ';
             }
-            if (item.dot_pos == (int)prod.right.size()) cout << ".";
+            if (item.dot_pos() == (int)prod.right.size()) cout << ".";
             cout << endl;
         }
         cout << "  [闭包项]" << endl;
         for (const auto& item : closure_items) {
-            const auto& prod = g.productions[item.production_id];
+            const auto& prod = g.productions[item.production_id()];
             cout << "    " << prod.left << " → ";
             for (int j = 0; j < (int)prod.right.size(); ++j) {
-                if (j == item.dot_pos) cout << ". ";
+                if (j == item.dot_pos()) cout << ". ";
                 cout << prod.right[j] << ' ';
             }
-            if (item.dot_pos == (int)prod.right.size()) cout << ".";
+            if (item.dot_pos() == (int)prod.right.size()) cout << ".";
             cout << endl;
         }
     }
@@ -557,131 +869,404 @@ struct SLRTable {
     map<int, map<string, int>> GOTO;
     // 冲突信息
     vector<string> conflicts;
+    // 按优先级和结合性解决的移进-归约冲突
+    vector<string> resolved;
+    // 出现过上述两类冲突的状态（增量重建时这些行总是重新计算；不写入缓存）
+    set<int> conflict_states;
+    // 其中有表项按 %nonassoc 置为出错的状态，这些状态不能用默认归约（见 ParseTable::compress）
+    set<int> error_states;
 };
 
-SLRTable build_slr_table(const Grammar& g, const CanonicalCollection& cc) {
-    SLRTable table;
-    
-    if (DEBUG_MODE) {
-        cout << "\n=== 构建SLR(1)分析表 ===" << endl;
+// 用优先级和结合性解决移进-归约冲突：
+// 返回 's' 移进，'r' 保留归约，'e' 该格置为出错（不可结合），0 表示未声明优先级、无法解决
+char resolve_shift_reduce(const Grammar& g, int production, const string& token) {
+    int pp = production < (int)g.production_prec.size() ? g.production_prec[production] : 0;
+    auto it = g.token_prec.find(token);
+    if (pp == 0 || it == g.token_prec.end()) return 0;
+    if (pp > it->second) return 'r';
+    if (pp < it->second) return 's';
+    switch (g.token_assoc.at(token)) {
+        case 'l': return 'r';
+        case 'r': return 's';
+        default: return 'e';
     }
-    
-    for (size_t i = 0; i < cc.C.size(); ++i) {
-        const ItemSet& I = cc.C[i];
-        
-        if (DEBUG_MODE) {
-            cout << "处理状态 I" << i << ":" << endl;
-        }
-        
-        // 1. 归约/接受
-        for (const auto& item : I.items) {
-            const auto& prod = g.productions[item.production_id];
-            // 归约项：点在最右
-            if (item.dot_pos == (int)prod.right.size()) {
-                if (prod.left == g.start_symbol) {
-                    // S' → S. 接受
-                    table.ACTION[i]["#"] = {'a', 0};  // 接受动作，value设为0
+}
+
+// 归约项的向前看符号：lookahead(状态, 产生式编号) 返回该状态下按该产生式归约时的向前看终结符
+typedef function<const set<string>&(int, int)> LookaheadFn;
+
+// 状态i的归约/接受动作
+static void add_reduce_actions(const Grammar& g, const CanonicalCollection& cc, int i,
+                               const LookaheadFn& lookahead, SLRTable& table) {
+    // 1. 归约/接受
+    for (const auto& item : cc.C[i].items) {
+        const auto& prod = g.productions[item.production_id()];
+        // 归约项：点在最右
+        if (item.dot_pos() == (int)prod.right.size()) {
+            if (prod.left == g.start_symbol) {
+                // S' → S. 接受
+                table.ACTION[i]["#"] = {'a', 0};  // 接受动作，value设为0
+                
+                if (DEBUG_MODE) {
+                    cout << "  设置 ACTION[" << i << ", #] = a" << endl;
+                }
+            } else {
+                // 对向前看符号集内的终结符填rX
+                for (const auto& a : lookahead(i, item.production_id())) {
+                    SLRAction& cell = table.ACTION[i][a];
+                    SLRAction act = {'r', item.production_id()};
                     
                     if (DEBUG_MODE) {
-                        cout << "  设置 ACTION[" << i << ", #] = a" << endl;
+                        cout << "  " << prod.left << " 的向前看符号包含 " << a;
+                        cout << "，设置 ACTION[" << i << ", " << a << "] = " << act << endl;
                     }
-                } else {
-                    // 对FOLLOW(left)内的终结符填rX
-                    for (const auto& a : g.follow.at(prod.left)) {
-                        SLRAction& cell = table.ACTION[i][a];
-                        SLRAction act = {'r', item.production_id};
+                    
+                    if (!cell.empty() && cell != act) {
+                        string conflict = "归约冲突: 状态" + to_string(i) + ", 符号" + a + 
+                                       ", " + string(1, cell.type) + to_string(cell.value) + 
+                                       " vs " + string(1, act.type) + to_string(act.value);
+                        table.conflicts.push_back(conflict);
+                        table.conflict_states.insert(i);
                         
                         if (DEBUG_MODE) {
-                            cout << "  " << prod.left << " 的FOLLOW集包含 " << a;
-                            cout << "，设置 ACTION[" << i << ", " << a << "] = " << act << endl;
-                        }
-                        
-                        if (!cell.empty() && cell != act) {
-                            string conflict = "归约冲突: 状态" + to_string(i) + ", 符号" + a + 
-                                           ", " + string(1, cell.type) + to_string(cell.value) + 
-                                           " vs " + string(1, act.type) + to_string(act.value);
-                            table.conflicts.push_back(conflict);
-                            
-                            if (DEBUG_MODE) {
-                                cout << " (冲突，已存在 " << cell << ")" << endl;
-                            }
+                            cout << " (冲突，已存在 " << cell << ")" << endl;
                         }
-                        
-                        cell = act;
                     }
+                    
+                    cell = act;
                 }
             }
         }
-        
-        // 2. 移进
-        for (const auto& t : g.terminals) {
-            auto it = cc.transitions.find({(int)i, t});
-            if (it != cc.transitions.end()) {
-                SLRAction& cell = table.ACTION[i][t];
-                SLRAction act = {'s', it->second};
+    }
+}
+
+// 状态i的移进动作和GOTO，冲突时按优先级裁决，否则移进覆盖已有动作
+static void add_shift_goto_actions(const Grammar& g, const CanonicalCollection& cc, int i, SLRTable& table) {
+    // 状态i的出边在transitions中连续存放并按符号名排序，只需遍历这一段，
+    // 不必对每个符号查一次表（符号数上万时逐个查找占了构造分析表的绝大部分时间）
+    auto first = cc.transitions.lower_bound({i, string()});
+    auto last = cc.transitions.lower_bound({i + 1, string()});
+    
+    // 2. 移进
+    for (auto it = first; it != last; ++it) {
+        const string& t = it->first.second;
+        if (g.terminals.count(t)) {
+            SLRAction& cell = table.ACTION[i][t];
+            SLRAction act = {'s', it->second};
+            
+            if (DEBUG_MODE) {
+                cout << "  状态 I" << i << " 通过 " << t << " 转移到 I" << it->second;
+                cout << "，设置 ACTION[" << i << ", " << t << "] = " << act << endl;
+            }
+            
+            char decision = cell.type == 'r' ? resolve_shift_reduce(g, cell.value, t) : 0;
+            if (decision != 0) {
+                static const char* const outcome[] = {"移进", "归约", "出错"};
+                const char* chosen = outcome[decision == 's' ? 0 : decision == 'r' ? 1 : 2];
+                table.resolved.push_back("按优先级解决: 状态" + to_string(i) + ", 符号" + t +
+                                         ", r" + to_string(cell.value) + " vs " +
+                                         string(1, act.type) + to_string(act.value) + " -> " + chosen);
+                table.conflict_states.insert(i);
                 
                 if (DEBUG_MODE) {
-                    cout << "  状态 I" << i << " 通过 " << t << " 转移到 I" << it->second;
-                    cout << "，设置 ACTION[" << i << ", " << t << "] = " << act << endl;
+                    cout << " (冲突，已存在 " << cell << "，按优先级取" << chosen << ")" << endl;
                 }
                 
-                if (!cell.empty() && cell != act) {
-                    string conflict = "移进冲突: 状态" + to_string(i) + ", 符号" + t + 
-                                    ", " + string(1, cell.type) + to_string(cell.value) + 
-                                    " vs " + string(1, act.type) + to_string(act.value);
-                    table.conflicts.push_back(conflict);
-                    
-                    if (DEBUG_MODE) {
-                        cout << " (冲突，已存在 " << cell << ")" << endl;
-                    }
+                if (decision == 's') {
+                    cell = act;
+                } else if (decision == 'e') {
+                    table.ACTION[i].erase(t);
+                    table.error_states.insert(i);
                 }
-                
-                cell = act;
+                continue;
             }
-        }
-        
-        // 3. GOTO
-        for (const auto& nt : g.nonterminals) {
-            auto it = cc.transitions.find({(int)i, nt});
-            if (it != cc.transitions.end()) {
-                table.GOTO[i][nt] = it->second;
+            
+            if (!cell.empty() && cell != act) {
+                string conflict = "移进冲突: 状态" + to_string(i) + ", 符号" + t + 
+                                ", " + string(1, cell.type) + to_string(cell.value) + 
+                                " vs " + string(1, act.type) + to_string(act.value);
+                table.conflicts.push_back(conflict);
+                table.conflict_states.insert(i);
                 
                 if (DEBUG_MODE) {
-                    cout << "  状态 I" << i << " 通过 " << nt << " 转移到 I" << it->second;
-                    cout << ", 设置 GOTO[" << i << ", " << nt << "] = " << it->second << endl;
+                    cout << " (冲突，已存在 " << cell << ")" << endl;
                 }
             }
+            
+            cell = act;
+        }
+    }
+    
+    // 3. GOTO
+    for (auto it = first; it != last; ++it) {
+        const string& nt = it->first.second;
+        if (g.nonterminals.count(nt)) {
+            table.GOTO[i][nt] = it->second;
+            
+            if (DEBUG_MODE) {
+                cout << "  状态 I" << i << " 通过 " << nt << " 转移到 I" << it->second;
+                cout << ", 设置 GOTO[" << i << ", " << nt << "] = " << it->second << endl;
+            }
         }
     }
-    return table;
 }
 
-void print_slr_table(const SLRTable& table, const Grammar& g, int state_count) {
-    vector<string> terms(g.terminals.begin(), g.terminals.end());
-    terms.push_back("#");
-    vector<string> nterms(g.nonterminals.begin(), g.nonterminals.end());
-    cout << "\n=== SLR(1)分析表 ===" << endl;
-    cout << setw(6) << "State";
-    for (const auto& t : terms) cout << setw(8) << t;
-    for (const auto& nt : nterms) {
-        if (nt == "S'") continue;
-        cout << setw(8) << nt;
+// 在LR(0)项目集规范族上填ACTION/GOTO，SLR(1)与LALR(1)只在归约的向前看符号上不同
+SLRTable build_lr_table(const Grammar& g, const CanonicalCollection& cc,
+                        const LookaheadFn& lookahead, const string& name) {
+    SLRTable table;
+    
+    if (DEBUG_MODE) {
+        cout << "\n=== 构建" << name << "分析表 ===" << endl;
     }
-    cout << endl;
-    for (int i = 0; i < state_count; ++i) {
-        cout << setw(6) << i;
-        for (const auto& t : terms) {
-            auto it = table.ACTION.find(i);
-            if (it != table.ACTION.end() && it->second.count(t))
-                cout << setw(8) << it->second.at(t);
-            else
-                cout << setw(8) << "";
+    
+    for (size_t i = 0; i < cc.C.size(); ++i) {
+        if (DEBUG_MODE) {
+            cout << "处理状态 I" << i << ":" << endl;
         }
-        for (const auto& nt : nterms) {
-            if (nt == "S'") continue;
-            auto it = table.GOTO.find(i);
-            if (it != table.GOTO.end() && it->second.count(nt))
-                cout << setw(8) << it->second.at(nt);
+        
+        add_reduce_actions(g, cc, i, lookahead, table);
+        add_shift_goto_actions(g, cc, i, table);
+    }
+    return table;
+}
+
+SLRTable build_slr_table(const Grammar& g, const CanonicalCollection& cc) {
+    // SLR(1)：归约的向前看符号取FOLLOW(左部)
+    return build_lr_table(g, cc, [&g](int, int p) -> const set<string>& {
+        return g.follow.at(g.productions[p].left);
+    }, "SLR(1)");
+}
+
+// ===== LALR(1)向前看符号（DeRemer–Pennello） =====
+// 在LR(0)项目集规范族上对每个非终结符转移(p, A)计算
+//   DR(p, A)     直接读入：GOTO(p, A)上可移进的终结符
+//   Read(p, A)   = DR(p, A) ∪ ⋃{ Read(r, C) | (p, A) reads (r, C) }，C可空
+//   Follow(p, A) = Read(p, A) ∪ ⋃{ Follow(p', B) | (p, A) includes (p', B) }
+// 再由lookback关系得到 LA(q, A → ω) = ⋃{ Follow(p, A) | (q, A → ω) lookback (p, A) }。
+// 两次闭包都用digraph算法按强连通分量一次求出，总体与关系规模成线性。
+
+// digraph算法的一次遍历：F为按位存放的终结符集合，每个结点W个字
+// 关系链可能很长（合成文法中includes/reads链上万层），用显式栈代替递归，
+// work中每一帧为 (结点, 入栈时的深度, 下一条待处理的边)
+struct DigraphFrame {
+    int x;
+    int d;
+    size_t next;
+};
+
+static void digraph_traverse(int root, const vector<vector<int>>& R, vector<uint64_t>& F, int W,
+                             vector<int>& N, vector<int>& stack, vector<DigraphFrame>& work) {
+    auto enter = [&](int x) {
+        stack.push_back(x);
+        N[x] = stack.size();
+        work.push_back({x, (int)stack.size(), 0});
+    };
+    enter(root);
+    while (!work.empty()) {
+        DigraphFrame& frame = work.back();
+        int x = frame.x;
+        if (frame.next < R[x].size()) {
+            int y = R[x][frame.next];
+            // y未访问时先遍历y，回到x后再处理这条边
+            if (N[y] == 0) {
+                enter(y);
+                continue;
+            }
+            ++frame.next;
+            N[x] = min(N[x], N[y]);
+            for (int w = 0; w < W; ++w) F[(size_t)x * W + w] |= F[(size_t)y * W + w];
+            continue;
+        }
+        if (N[x] == frame.d) {
+            // x是强连通分量的根，分量内结点共享同一集合
+            while (true) {
+                int top = stack.back();
+                stack.pop_back();
+                N[top] = INT_MAX;
+                if (top == x) break;
+                copy(F.begin() + (size_t)x * W, F.begin() + (size_t)(x + 1) * W, F.begin() + (size_t)top * W);
+            }
+        }
+        work.pop_back();
+    }
+}
+
+static void digraph(const vector<vector<int>>& R, vector<uint64_t>& F, int W) {
+    vector<int> N(R.size(), 0);
+    vector<int> stack;
+    vector<DigraphFrame> work;
+    for (size_t x = 0; x < R.size(); ++x) {
+        if (N[x] == 0) digraph_traverse(x, R, F, W, N, stack, work);
+    }
+}
+
+// 返回 (状态, 产生式编号) -> LALR(1)向前看终结符
+map<pair<int, int>, set<string>> build_lalr_lookaheads(const Grammar& g, const CanonicalCollection& cc) {
+    int ntc = g.nonterminal_count;
+    int state_count = cc.C.size();
+    // 终结符按字典序编号，"#"在最后
+    vector<string> terms(g.terminals.begin(), g.terminals.end());
+    terms.push_back("#");
+    int end_marker = terms.size() - 1;
+    int W = (terms.size() + 63) / 64;
+
+    // 每个状态的出边按符号编号排序，便于二分查找
+    vector<vector<pair<int, int>>> succ(state_count);
+    for (const auto& t : cc.transitions) {
+        succ[t.first.first].push_back({g.symbol_id.at(t.first.second), t.second});
+    }
+    for (auto& edges : succ) sort(edges.begin(), edges.end());
+    auto go = [&succ](int state, int sym) {
+        auto it = lower_bound(succ[state].begin(), succ[state].end(), make_pair(sym, INT_MIN));
+        return (it != succ[state].end() && it->first == sym) ? it->second : -1;
+    };
+
+    // 可空非终结符
+    vector<char> nullable(ntc, 0);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t p = 0; p < g.productions.size(); ++p) {
+            int A = g.symbol_id.at(g.productions[p].left);
+            if (nullable[A]) continue;
+            bool all = true;
+            for (int sym : g.rhs_ids[p]) {
+                if (sym >= ntc || !nullable[sym]) { all = false; break; }
+            }
+            if (all) nullable[A] = changed = true;
+        }
+    }
+
+    // 非终结符转移编号
+    vector<pair<int, int>> trans;
+    map<pair<int, int>, int> trans_id;
+    for (int s = 0; s < state_count; ++s) {
+        for (const auto& e : succ[s]) {
+            if (e.first < ntc) {
+                trans_id[{s, e.first}] = trans.size();
+                trans.push_back({s, e.first});
+            }
+        }
+    }
+    int n = trans.size();
+
+    // DR与reads
+    vector<uint64_t> F((size_t)n * W, 0);
+    vector<vector<int>> reads(n);
+    Item accept_item(0, 1);
+    for (int x = 0; x < n; ++x) {
+        int r = go(trans[x].first, trans[x].second);
+        for (const auto& e : succ[r]) {
+            if (e.first >= ntc) {
+                int t = e.first - ntc;
+                F[(size_t)x * W + t / 64] |= 1ULL << (t % 64);
+            } else if (nullable[e.first]) {
+                reads[x].push_back(trans_id.at({r, e.first}));
+            }
+        }
+        // 含 S' → S. 的状态在输入结束符上可接受
+        const auto& items = cc.C[r].items;
+        if (binary_search(items.begin(), items.end(), accept_item)) {
+            F[(size_t)x * W + end_marker / 64] |= 1ULL << (end_marker % 64);
+        }
+    }
+    digraph(reads, F, W);
+
+    // includes与lookback：沿 B → β 从p'走到q
+    vector<vector<int>> includes(n);
+    vector<tuple<int, int, int>> lookback;  // (q, 产生式, 转移x)
+    for (int x = 0; x < n; ++x) {
+        int p0 = trans[x].first;
+        int B = trans[x].second;
+        for (int prod : g.nt_productions[B]) {
+            const auto& rhs = g.rhs_ids[prod];
+            // suffix_nullable[j]：rhs[j+1..]全部可空
+            vector<char> suffix_nullable(rhs.size() + 1, 1);
+            for (int j = (int)rhs.size() - 1; j > 0; --j) {
+                suffix_nullable[j - 1] = suffix_nullable[j] && rhs[j] < ntc && nullable[rhs[j]];
+            }
+            int q = p0;
+            for (size_t j = 0; j < rhs.size() && q >= 0; ++j) {
+                if (rhs[j] < ntc && suffix_nullable[j]) {
+                    includes[trans_id.at({q, rhs[j]})].push_back(x);
+                }
+                q = go(q, rhs[j]);
+            }
+            if (q >= 0) lookback.emplace_back(q, prod, x);
+        }
+    }
+    digraph(includes, F, W);
+
+    map<pair<int, int>, set<string>> LA;
+    for (const auto& lb : lookback) {
+        int x = get<2>(lb);
+        set<string>& la = LA[{get<0>(lb), get<1>(lb)}];
+        for (size_t t = 0; t < terms.size(); ++t) {
+            if (F[(size_t)x * W + t / 64] >> (t % 64) & 1) la.insert(terms[t]);
+        }
+    }
+
+    if (DEBUG_MODE) {
+        cout << "\n=== LALR(1)向前看符号 ===" << endl;
+        cout << "非终结符转移数: " << n << ", lookback数: " << lookback.size() << endl;
+        for (const auto& entry : LA) {
+            cout << "I" << entry.first.first << " 产生式" << entry.first.second << ": {";
+            bool first = true;
+            for (const auto& a : entry.second) {
+                cout << (first ? " " : ", ") << a;
+                first = false;
+            }
+            cout << " }" << endl;
+        }
+    }
+    return LA;
+}
+
+SLRTable build_lalr_table(const Grammar& g, const CanonicalCollection& cc) {
+    map<pair<int, int>, set<string>> LA = build_lalr_lookaheads(g, cc);
+    static const set<string> none;
+    return build_lr_table(g, cc, [&LA](int state, int p) -> const set<string>& {
+        auto it = LA.find({state, p});
+        return it == LA.end() ? none : it->second;
+    }, "LALR(1)");
+}
+
+// 比较SLR(1)与LALR(1)分析表的冲突数
+void print_conflict_comparison(const SLRTable& slr, const SLRTable& lalr) {
+    int resolved = (int)slr.conflicts.size() - (int)lalr.conflicts.size();
+    cout << "\n=== SLR(1)与LALR(1)冲突对比 ===" << endl;
+    cout << "SLR(1)冲突数: " << slr.conflicts.size() << endl;
+    cout << "LALR(1)冲突数: " << lalr.conflicts.size() << endl;
+    cout << "LALR(1)消除的冲突数: " << max(resolved, 0) << endl;
+}
+
+void print_slr_table(const SLRTable& table, const Grammar& g, int state_count,
+                     const string& name = "SLR(1)") {
+    vector<string> terms(g.terminals.begin(), g.terminals.end());
+    terms.push_back("#");
+    vector<string> nterms(g.nonterminals.begin(), g.nonterminals.end());
+    cout << "\n=== " << name << "分析表 ===" << endl;
+    cout << setw(6) << "State";
+    for (const auto& t : terms) cout << setw(8) << t;
+    for (const auto& nt : nterms) {
+        if (nt == "S'") continue;
+        cout << setw(8) << nt;
+    }
+    cout << endl;
+    for (int i = 0; i < state_count; ++i) {
+        cout << setw(6) << i;
+        for (const auto& t : terms) {
+            auto it = table.ACTION.find(i);
+            if (it != table.ACTION.end() && it->second.count(t))
+                cout << setw(8) << it->second.at(t);
+            else
+                cout << setw(8) << "";
+        }
+        for (const auto& nt : nterms) {
+            if (nt == "S'") continue;
+            auto it = table.GOTO.find(i);
+            if (it != table.GOTO.end() && it->second.count(nt))
+                cout << setw(8) << it->second.at(nt);
             else
                 cout << setw(8) << "";
         }
@@ -691,17 +1276,1656 @@ void print_slr_table(const SLRTable& table, const Grammar& g, int state_count) {
         cout << "\n[冲突信息]" << endl;
         for (const auto& c : table.conflicts) cout << c << endl;
     }
+    if (!table.resolved.empty()) {
+        cout << "\n[按优先级解决的冲突]" << endl;
+        for (const auto& c : table.resolved) cout << c << endl;
+    }
 }
 
-#ifdef LR0_MAIN
-int main(int argc, char* argv[]) {
-    for (int i = 1; i < argc; i++) {
-        string arg = argv[i];
-        if (arg == "--debug" || arg == "-d") {
-            DEBUG_MODE = true;
+// ===== 文法修改后的增量重建 =====
+// 已有旧文法的项目集规范族和SLR(1)分析表时，只重算受修改影响的部分：
+//   1. 新旧符号按名字对应，同一左部下按右部符号编号序列匹配新旧产生式，
+//      有产生式增删的左部记为已修改的非终结符；
+//   2. 只重算依赖已修改非终结符的FIRST集，以及可能因此改变的FOLLOW集，用工作表沿依赖边传播；
+//      只增不删产生式时新集合包含旧集合，直接从旧值出发补充；
+//   3. 旧状态保留原编号：内核含被删产生式的状态删除；闭包中点后是已修改非终结符（或含被删产生式）的
+//      状态重新求闭包和出边，新出边与原有的逐条对比更新；其余状态连同出边原样保留，只换产生式编号。
+//      删去不可达的状态后用编号最大的状态填补空位，只有这些状态改编号；
+//   4. 分析表行也按原编号沿用：没有冲突的行只重算出边或向前看符号有变化的列，
+//      修补时出现冲突的行、原来有冲突的行和新状态的行整行重算。
+// 旧结果的项目集、转移和分析表行直接移入新结果，不做复制。
+// 得到的状态编号与完全重建不同，但自动机同构（见 equivalent_tables）。
+
+struct IncrementalStats {
+    int changed_productions = 0;  // 新增和删除的产生式数
+    int first_recomputed = 0;     // 重新计算FIRST集的非终结符数
+    int follow_recomputed = 0;    // 重新计算FOLLOW集的非终结符数
+    int reused_states = 0;        // 原样保留的旧状态
+    int recomputed_states = 0;    // 重新求闭包的旧状态
+    int new_states = 0;           // 新增的状态
+    int dropped_states = 0;       // 删除或不再可达的旧状态
+    int reused_rows = 0;          // 直接沿用的分析表行
+    int patched_rows = 0;         // 只重算了部分列的分析表行
+};
+
+// 把图中结点排成拓扑序（深度优先的逆后序，有环时环内顺序任意），
+// 工作表按这个顺序处理，无环的依赖链上每个结点只需处理一次
+static vector<int> topological_order(const vector<vector<int>>& edges) {
+    int n = edges.size();
+    vector<char> seen(n, 0);
+    vector<int> order;
+    vector<pair<int, size_t>> stack;  // 依赖链可能很长，用显式栈代替递归
+    for (int root = 0; root < n; ++root) {
+        if (seen[root]) continue;
+        seen[root] = 1;
+        stack.push_back({root, 0});
+        while (!stack.empty()) {
+            int v = stack.back().first;
+            size_t k = stack.back().second++;
+            if (k < edges[v].size()) {
+                int w = edges[v][k];
+                if (!seen[w]) {
+                    seen[w] = 1;
+                    stack.push_back({w, 0});
+                }
+            } else {
+                order.push_back(v);
+                stack.pop_back();
+            }
+        }
+    }
+    reverse(order.begin(), order.end());
+    return order;
+}
+
+// 由旧文法old_g及其规范族、SLR(1)分析表增量构造新文法rules的结果，写入g、cc、table。
+// old_table须由 build_slr_table 构造（其 conflict_states 不写入缓存）。
+// 能沿用的部分从旧结果中移走，调用后old_g、old_cc、old_table不再可用。
+IncrementalStats rebuild_incremental(Grammar&& old_g, CanonicalCollection&& old_cc,
+                                     SLRTable&& old_table, const vector<string>& rules,
+                                     Grammar& g, CanonicalCollection& cc, SLRTable& table) {
+    IncrementalStats st;
+    g = Grammar();
+    g.parse(rules);
+    int nt_count = g.nonterminal_count;
+    int old_nt_count = old_g.nonterminal_count;
+
+    // 1. 匹配新旧产生式，相同的产生式按出现顺序一一对应
+    // 终结符和非终结符互换了的符号当作不同的符号，用到它的产生式都算增删过
+    vector<int> old_sym(g.symbols.size(), -1);      // 新符号编号 -> 旧编号，-1 表示新出现的符号
+    vector<int> new_sym(old_g.symbols.size(), -1);  // 旧符号编号 -> 新编号，-1 表示已不再出现
+    for (size_t s = 0; s < g.symbols.size(); ++s) {
+        auto it = old_g.symbol_id.find(g.symbols[s]);
+        if (it == old_g.symbol_id.end()) continue;
+        if (((int)s < nt_count) != (it->second < old_nt_count)) continue;
+        old_sym[s] = it->second;
+        new_sym[it->second] = s;
+    }
+    vector<int> lhs(g.productions.size()), old_lhs(old_g.productions.size());
+    for (int A = 0; A < nt_count; ++A) {
+        for (int p : g.nt_productions[A]) lhs[p] = A;
+    }
+    for (int A = 0; A < old_nt_count; ++A) {
+        for (int p : old_g.nt_productions[A]) old_lhs[p] = A;
+    }
+    auto same_rhs = [&](int p, int q) {
+        const vector<int>& a = old_g.rhs_ids[p];
+        const vector<int>& b = g.rhs_ids[q];
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (old_sym[b[i]] != a[i]) return false;
+        }
+        return true;
+    };
+    vector<int> prod_map(old_g.productions.size(), -1);  // 旧产生式编号 -> 新编号，-1 表示已删除
+    vector<char> new_matched(g.productions.size(), 0);
+    for (int A = 0; A < nt_count; ++A) {
+        if (old_sym[A] < 0) continue;
+        const vector<int>& olds = old_g.nt_productions[old_sym[A]];
+        size_t first_free = 0;  // olds中在它之前的都已匹配；产生式顺序不变时每次第一个就匹配上
+        for (int q : g.nt_productions[A]) {
+            while (first_free < olds.size() && prod_map[olds[first_free]] >= 0) ++first_free;
+            for (size_t k = first_free; k < olds.size(); ++k) {
+                int p = olds[k];
+                if (prod_map[p] < 0 && same_rhs(p, q)) {
+                    prod_map[p] = q;
+                    new_matched[q] = 1;
+                    break;
+                }
+            }
+        }
+    }
+    vector<char> changed(nt_count, 0);                   // 已修改的非终结符（新编号）
+    vector<char> changed_old(old_g.symbols.size(), 0);   // 同上（旧编号）
+    bool additive = true;  // 只新增了产生式：新文法的FIRST/FOLLOW集都包含旧的
+    for (size_t p = 0; p < old_g.productions.size(); ++p) {
+        if (prod_map[p] >= 0) continue;
+        ++st.changed_productions;
+        additive = false;
+        changed_old[old_lhs[p]] = 1;
+        if (new_sym[old_lhs[p]] >= 0) changed[new_sym[old_lhs[p]]] = 1;
+    }
+    for (size_t q = 0; q < g.productions.size(); ++q) {
+        if (new_matched[q]) continue;
+        ++st.changed_productions;
+        changed[lhs[q]] = 1;
+        if (old_sym[lhs[q]] >= 0) changed_old[old_sym[lhs[q]]] = 1;
+    }
+
+    if (prod_map[0] != 0) {
+        // 开始符号变了，所有状态都受影响，直接完全重建
+        g.compute_first();
+        g.compute_follow();
+        cc = build_canonical_collection(g);
+        table = build_slr_table(g, cc);
+        st.first_recomputed = st.follow_recomputed = g.nonterminals.size();
+        st.new_states = cc.C.size();
+        st.dropped_states = old_cc.C.size();
+        return st;
+    }
+
+    // 2. FIRST：已修改的非终结符，以及FIRST集（传递地）依赖它们的非终结符。
+    // A → X1 … Xi … 中 X1 … Xi-1 在新文法或旧文法中可空时，FIRST(A) 依赖 FIRST(Xi)
+    vector<char> nullable(nt_count, 0), old_nullable(nt_count, 0);
+    for (bool grew = true; grew;) {
+        grew = false;
+        for (size_t p = 0; p < g.productions.size(); ++p) {
+            int A = lhs[p];
+            if (nullable[A]) continue;
+            bool all = true;
+            for (int sym : g.rhs_ids[p]) {
+                if (sym >= nt_count || !nullable[sym]) { all = false; break; }
+            }
+            if (all) nullable[A] = grew = true;
+        }
+    }
+    for (int A = 0; A < nt_count; ++A) {
+        auto it = old_g.first.find(g.symbols[A]);
+        old_nullable[A] = it != old_g.first.end() && it->second.count("ε");
+    }
+    vector<vector<int>> users(nt_count);  // B -> FIRST集依赖FIRST(B)的非终结符
+    for (size_t p = 0; p < g.productions.size(); ++p) {
+        for (int sym : g.rhs_ids[p]) {
+            if (sym >= nt_count) break;
+            users[sym].push_back(lhs[p]);
+            if (!nullable[sym] && !old_nullable[sym]) break;
+        }
+    }
+    vector<char> first_dirty(nt_count, 0);
+    vector<int> work;
+    auto mark_first = [&](int A) {
+        if (!first_dirty[A]) {
+            first_dirty[A] = 1;
+            work.push_back(A);
+        }
+    };
+    for (int A = 0; A < nt_count; ++A) {
+        if (changed[A] || old_sym[A] < 0) mark_first(A);
+    }
+    while (!work.empty()) {
+        int B = work.back();
+        work.pop_back();
+        for (int A : users[B]) mark_first(A);
+    }
+
+    // 未受影响的集合直接从旧文法移过来；只增不删时受影响的也从旧值出发，否则从空集开始
+    for (const auto& t : g.terminals) g.first[t] = {t};
+    g.first["ε"] = {"ε"};
+    vector<set<string>*> first_set(g.symbols.size());
+    for (size_t s = 0; s < g.symbols.size(); ++s) first_set[s] = &g.first[g.symbols[s]];
+    vector<size_t> old_size(nt_count, 0);
+    for (int A = 0; A < nt_count; ++A) {
+        if (old_sym[A] < 0 || (first_dirty[A] && !additive)) continue;
+        *first_set[A] = move(old_g.first[g.symbols[A]]);
+        old_size[A] = first_set[A]->size();
+    }
+    vector<char> queued(nt_count, 0);
+    vector<int> queue;
+    for (int A : topological_order(users)) {
+        if (first_dirty[A]) {
+            queue.push_back(A);
+            queued[A] = 1;
+        }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int A = queue[head];
+        queued[A] = 0;
+        set<string>& fa = *first_set[A];
+        size_t before = fa.size();
+        for (int p : g.nt_productions[A]) {
+            for (int sym : g.rhs_ids[p]) {
+                if (sym >= nt_count) {
+                    fa.insert(g.symbols[sym]);
+                    break;
+                }
+                if (sym != A) {
+                    for (const auto& f : *first_set[sym]) {
+                        if (f != "ε") fa.insert(f);
+                    }
+                }
+                if (!nullable[sym]) break;
+            }
+        }
+        if (nullable[A]) fa.insert("ε");
+        if (fa.size() == before) continue;
+        for (int U : users[A]) {
+            if (first_dirty[U] && !queued[U]) {
+                queued[U] = 1;
+                queue.push_back(U);
+            }
+        }
+    }
+    vector<char> first_changed(nt_count, 0);  // 重算后确实变了的
+    for (int A = 0; A < nt_count; ++A) {
+        if (!first_dirty[A]) continue;
+        ++st.first_recomputed;
+        if (old_sym[A] < 0) first_changed[A] = 1;
+        else if (additive) first_changed[A] = first_set[A]->size() != old_size[A];
+        else first_changed[A] = old_g.first[g.symbols[A]] != *first_set[A];
+    }
+
+    // FOLLOW：增删的产生式右部中的非终结符、后面跟着FIRST集有变化的符号的非终结符，
+    // 再沿 A → αB(可空) 从FOLLOW(A)传到FOLLOW(B)
+    vector<char> follow_dirty(nt_count, 0);
+    auto mark_follow = [&](int B) {
+        if (B >= 0 && B < nt_count && !follow_dirty[B]) {
+            follow_dirty[B] = 1;
+            work.push_back(B);
+        }
+    };
+    for (size_t p = 0; p < old_g.productions.size(); ++p) {
+        if (prod_map[p] >= 0) continue;
+        for (int sym : old_g.rhs_ids[p]) mark_follow(new_sym[sym]);
+    }
+    for (size_t q = 0; q < g.productions.size(); ++q) {
+        const vector<int>& rhs = g.rhs_ids[q];
+        bool suffix_changed = false;  // FIRST(rhs[i+1..]) 可能有变化
+        for (int i = (int)rhs.size() - 1; i >= 0; --i) {
+            if (!new_matched[q] || suffix_changed) mark_follow(rhs[i]);
+            int sym = rhs[i];
+            bool is_nt = sym < nt_count;
+            bool may_be_nullable = is_nt && (nullable[sym] || old_nullable[sym]);
+            suffix_changed = (is_nt && first_changed[sym]) || (may_be_nullable && suffix_changed);
+        }
+    }
+    for (int A = 0; A < nt_count; ++A) {
+        if (old_sym[A] < 0) mark_follow(A);
+    }
+    while (!work.empty()) {
+        int A = work.back();
+        work.pop_back();
+        for (int p : g.nt_productions[A]) {
+            const vector<int>& rhs = g.rhs_ids[p];
+            for (int i = (int)rhs.size() - 1; i >= 0; --i) {
+                mark_follow(rhs[i]);
+                if (rhs[i] >= nt_count || !nullable[rhs[i]]) break;
+            }
+        }
+    }
+    vector<set<string>*> follow_set(nt_count);
+    for (int A = 0; A < nt_count; ++A) {
+        follow_set[A] = &g.follow[g.symbols[A]];
+        if (old_sym[A] < 0 || (follow_dirty[A] && !additive)) continue;
+        *follow_set[A] = move(old_g.follow[g.symbols[A]]);
+    }
+    // 从旧值出发时新加入的符号就是FOLLOW集的增量，顺便记下，修补分析表行时用
+    vector<vector<string>> follow_added(nt_count), follow_removed(nt_count);
+    auto add_follow = [&](int B, const string& f) {
+        if (follow_set[B]->insert(f).second && additive) follow_added[B].push_back(f);
+    };
+    add_follow(g.symbol_id.at(g.start_symbol), "#");
+    vector<vector<int>> follow_edges(nt_count);  // A -> B：FOLLOW(A) 并入 FOLLOW(B)
+    for (size_t q = 0; q < g.productions.size(); ++q) {
+        const vector<int>& rhs = g.rhs_ids[q];
+        for (size_t i = 0; i < rhs.size(); ++i) {
+            int B = rhs[i];
+            if (B >= nt_count || !follow_dirty[B]) continue;
+            // A → αBβ：FIRST(β)中除ε外的符号加入FOLLOW(B)，β可空时FOLLOW(A)也要并入
+            bool beta_nullable = true;
+            for (size_t j = i + 1; j < rhs.size() && beta_nullable; ++j) {
+                int sym = rhs[j];
+                if (sym >= nt_count) {
+                    add_follow(B, g.symbols[sym]);
+                    beta_nullable = false;
+                    continue;
+                }
+                for (const auto& f : *first_set[sym]) {
+                    if (f != "ε") add_follow(B, f);
+                }
+                beta_nullable = nullable[sym];
+            }
+            if (beta_nullable && lhs[q] != B) follow_edges[lhs[q]].push_back(B);
+        }
+    }
+    queue.clear();
+    for (int A : topological_order(follow_edges)) {
+        if (!follow_edges[A].empty()) {
+            queue.push_back(A);
+            queued[A] = 1;
+        }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        int A = queue[head];
+        queued[A] = 0;
+        for (int B : follow_edges[A]) {
+            size_t before = follow_set[B]->size();
+            for (const auto& f : *follow_set[A]) add_follow(B, f);
+            if (follow_set[B]->size() != before && !follow_edges[B].empty() && !queued[B]) {
+                queued[B] = 1;
+                queue.push_back(B);
+            }
+        }
+    }
+    vector<char> follow_changed(nt_count, 0);
+    for (int A = 0; A < nt_count; ++A) {
+        if (!follow_dirty[A]) continue;
+        ++st.follow_recomputed;
+        const set<string>& now = *follow_set[A];
+        if (old_sym[A] < 0) {
+            follow_added[A].assign(now.begin(), now.end());
+        } else if (!additive) {
+            const set<string>& old = old_g.follow[g.symbols[A]];
+            set_difference(now.begin(), now.end(), old.begin(), old.end(), back_inserter(follow_added[A]));
+            set_difference(old.begin(), old.end(), now.begin(), now.end(), back_inserter(follow_removed[A]));
+        }
+        follow_changed[A] = !follow_added[A].empty() || !follow_removed[A].empty();
+    }
+
+    // 3. 判定旧状态：删除(dead)、需要重新求闭包(dirty)、原样保留（只换产生式编号）
+    int old_n = old_cc.C.size();
+    bool renumber_productions = false;
+    for (size_t p = 0; p < prod_map.size(); ++p) {
+        if (prod_map[p] != (int)p) renumber_productions = true;
+    }
+    cc = CanonicalCollection();
+    cc.C = move(old_cc.C);
+    cc.transitions = move(old_cc.transitions);
+    vector<char> dead(old_n, 0), dirty(old_n, 0);
+    map<vector<Item>, int> kernel_id;
+    for (int o = 0; o < old_n; ++o) {
+        vector<Item> kernel;
+        for (const auto& item : cc.C[o].items) {
+            int p = item.production_id(), d = item.dot_pos();
+            bool is_kernel = d > 0 || p == 0;
+            if (prod_map[p] < 0) {
+                if (is_kernel) dead[o] = 1;
+                dirty[o] = 1;
+                continue;
+            }
+            if (is_kernel) kernel.push_back(Item(prod_map[p], d));
+            const auto& rhs = old_g.rhs_ids[p];
+            if (d < (int)rhs.size() && changed_old[rhs[d]]) dirty[o] = 1;
+        }
+        if (dead[o]) continue;  // 没有转移再指向它，下面按不可达删除
+        sort(kernel.begin(), kernel.end());
+        vector<Item>& items = cc.C[o].items;
+        if (dirty[o]) {
+            cc.C[o] = closure(kernel, g);
+        } else if (renumber_productions) {
+            for (auto& item : items) item = Item(prod_map[item.production_id()], item.dot_pos());
+            if (!is_sorted(items.begin(), items.end())) sort(items.begin(), items.end());
+        }
+        kernel_id.emplace(move(kernel), o);
+    }
+
+    // 保留状态的出边原样留在transitions中（目标内核只含保留下来的产生式，目标状态一定还在）。
+    // 重新求闭包的状态和新状态按构造规范族的方式扩展，前者的新出边与原有出边逐条对比，
+    // 记下有变化的符号，分析表行只需重算这些列
+    vector<int> origin(old_n);  // 状态 -> 旧状态，-1 表示新增
+    for (int o = 0; o < old_n; ++o) origin[o] = o;
+    vector<vector<string>> touched(old_n);
+    vector<int> pending;
+    for (int o = 0; o < old_n; ++o) {
+        if (dirty[o] && !dead[o]) pending.push_back(o);
+    }
+    for (size_t w = 0; w < pending.size(); ++w) {
+        int id = pending[w];
+        vector<pair<int, vector<Item>>> out = goto_kernels(cc.C[id], g);
+        vector<pair<const string*, int>> edges;
+        for (auto& k : out) {
+            auto found = kernel_id.find(k.second);
+            int target;
+            if (found == kernel_id.end()) {
+                target = cc.C.size();
+                cc.C.push_back(closure(k.second, g));
+                origin.push_back(-1);
+                kernel_id.emplace(move(k.second), target);
+                pending.push_back(target);
+            } else {
+                target = found->second;
+            }
+            edges.push_back({&g.symbols[k.first], target});
+        }
+        // transitions中同一状态的出边按符号名排序
+        sort(edges.begin(), edges.end(), [](const pair<const string*, int>& a, const pair<const string*, int>& b) {
+            return *a.first < *b.first;
+        });
+        vector<string>* log = id < old_n ? &touched[id] : nullptr;
+        auto it = cc.transitions.lower_bound({id, string()});
+        auto in_range = [&]() { return it != cc.transitions.end() && it->first.first == id; };
+        for (const auto& e : edges) {
+            while (in_range() && it->first.second < *e.first) {
+                if (log) log->push_back(it->first.second);
+                it = cc.transitions.erase(it);
+            }
+            if (in_range() && it->first.second == *e.first) {
+                if (it->second != e.second) {
+                    if (log) log->push_back(*e.first);
+                    it->second = e.second;
+                }
+                ++it;
+            } else {
+                if (log) log->push_back(*e.first);
+                cc.transitions.emplace_hint(it, make_pair(id, *e.first), e.second);
+            }
+        }
+        while (in_range()) {
+            if (log) log->push_back(it->first.second);
+            it = cc.transitions.erase(it);
+        }
+    }
+
+    // 删掉不再可达的状态，空位由编号最大的可达状态依次填补
+    int n = cc.C.size();
+    vector<char> reachable(n, 0);
+    vector<int> stack = {0};
+    reachable[0] = 1;
+    while (!stack.empty()) {
+        int s = stack.back();
+        stack.pop_back();
+        for (auto it = cc.transitions.lower_bound({s, string()}); it != cc.transitions.end() && it->first.first == s; ++it) {
+            if (!reachable[it->second]) {
+                reachable[it->second] = 1;
+                stack.push_back(it->second);
+            }
+        }
+    }
+    int kept = count(reachable.begin(), reachable.end(), 1);
+    vector<int> renum(n, -1);
+    for (int s = 0; s < n; ++s) {
+        if (reachable[s]) renum[s] = s;
+    }
+    vector<pair<int, int>> moves;  // (原编号, 新编号)
+    for (int lo = 0, hi = n - 1; lo < kept; ++lo) {
+        if (reachable[lo]) continue;
+        while (!reachable[hi]) --hi;
+        renum[hi] = lo;
+        moves.push_back({hi, lo});
+        --hi;
+    }
+    for (int s = 0; s < n; ++s) {
+        if (!reachable[s]) {
+            cc.transitions.erase(cc.transitions.lower_bound({s, string()}), cc.transitions.lower_bound({s + 1, string()}));
+        }
+    }
+    for (const auto& m : moves) {
+        auto first = cc.transitions.lower_bound({m.first, string()});
+        auto last = cc.transitions.lower_bound({m.first + 1, string()});
+        vector<pair<string, int>> out;
+        for (auto it = first; it != last; ++it) out.push_back({it->first.second, it->second});
+        cc.transitions.erase(first, last);
+        auto hint = cc.transitions.lower_bound({m.second + 1, string()});
+        for (auto& e : out) cc.transitions.emplace_hint(hint, make_pair(m.second, move(e.first)), e.second);
+        cc.C[m.second] = move(cc.C[m.first]);
+        origin[m.second] = origin[m.first];
+    }
+    cc.C.resize(kept);
+    origin.resize(kept);
+    if (!moves.empty()) {
+        for (auto& t : cc.transitions) t.second = renum[t.second];
+    }
+    for (int o : origin) {
+        if (o < 0) ++st.new_states;
+        else if (dirty[o]) ++st.recomputed_states;
+        else ++st.reused_states;
+    }
+    st.dropped_states = old_n - st.reused_states - st.recomputed_states;
+
+    // 4. 分析表：旧行按状态和产生式的新编号改写后留用，再修补或重算受影响的行
+    table = SLRTable();
+    table.ACTION = move(old_table.ACTION);
+    table.GOTO = move(old_table.GOTO);
+    for (int o = 0; o < old_n; ++o) {
+        if (!reachable[o]) {
+            table.ACTION.erase(o);
+            table.GOTO.erase(o);
+        }
+    }
+    for (const auto& m : moves) {
+        if (m.first >= old_n) continue;
+        auto row = table.ACTION.find(m.first);
+        if (row != table.ACTION.end()) {
+            map<string, SLRAction> actions = move(row->second);
+            table.ACTION.erase(row);
+            table.ACTION[m.second] = move(actions);
+        }
+        auto go_row = table.GOTO.find(m.first);
+        if (go_row != table.GOTO.end()) {
+            map<string, int> gotos = move(go_row->second);
+            table.GOTO.erase(go_row);
+            table.GOTO[m.second] = move(gotos);
+        }
+    }
+    if (!moves.empty() || renumber_productions) {
+        for (auto& row : table.ACTION) {
+            for (auto& a : row.second) {
+                if (a.second.type == 's') a.second.value = renum[a.second.value];
+                else if (a.second.type == 'r') a.second.value = prod_map[a.second.value];
+            }
+        }
+    }
+    if (!moves.empty()) {
+        for (auto& row : table.GOTO) {
+            for (auto& e : row.second) e.second = renum[e.second];
+        }
+    }
+
+    // 按当前项目集和出边重算状态i的cols各列；某列出现冲突时返回false，由调用者整行重算以报告冲突
+    auto patch_row = [&](int i, const vector<int>& reductions, bool accepts, vector<string>& cols) {
+        sort(cols.begin(), cols.end());
+        cols.erase(unique(cols.begin(), cols.end()), cols.end());
+        map<string, SLRAction>& actions = table.ACTION[i];
+        map<string, int>& gotos = table.GOTO[i];
+        for (const string& t : cols) {
+            auto sym = g.symbol_id.find(t);
+            bool known = sym != g.symbol_id.end();
+            auto tr = cc.transitions.find({i, t});
+            bool has_edge = tr != cc.transitions.end();
+            if (t == "#" || (known && sym->second >= nt_count)) {
+                SLRAction act = {'\0', 0};
+                int candidates = 0;
+                if (t == "#" && accepts) {
+                    act = {'a', 0};
+                    ++candidates;
+                }
+                for (int p : reductions) {
+                    if (follow_set[lhs[p]]->count(t)) {
+                        act = {'r', p};
+                        ++candidates;
+                    }
+                }
+                if (has_edge) {
+                    act = {'s', tr->second};
+                    ++candidates;
+                }
+                if (candidates > 1) return false;
+                if (candidates == 0) actions.erase(t);
+                else actions[t] = act;
+            } else {
+                actions.erase(t);
+            }
+            if (known && sym->second < nt_count && has_edge) gotos[t] = tr->second;
+            else gotos.erase(t);
+        }
+        if (actions.empty()) table.ACTION.erase(i);
+        if (gotos.empty()) table.GOTO.erase(i);
+        return true;
+    };
+    LookaheadFn follow_of = [&g](int, int p) -> const set<string>& {
+        return g.follow.at(g.productions[p].left);
+    };
+    for (int i = 0; i < kept; ++i) {
+        int o = origin[i];
+        bool fresh = o < 0 || old_table.conflict_states.count(o);
+        vector<int> reductions;  // 归约项的产生式（不含接受项 S' → S.）
+        bool accepts = false, lookahead_changed = false;
+        for (size_t k = 0; !fresh && k < cc.C[i].items.size(); ++k) {
+            const Item& item = cc.C[i].items[k];
+            int p = item.production_id();
+            if (item.dot_pos() != (int)g.rhs_ids[p].size()) continue;
+            if (p == 0) {
+                accepts = true;
+                continue;
+            }
+            reductions.push_back(p);
+            if (follow_changed[lhs[p]]) lookahead_changed = true;
+        }
+        if (!fresh && !dirty[o] && !lookahead_changed) {
+            ++st.reused_rows;
+            continue;
+        }
+        if (!fresh) {
+            vector<string> cols;
+            if (dirty[o]) {
+                // 出边有变化的列；归约项有增删的，旧行中已不再归约的列和新归约项的全部向前看符号
+                cols = move(touched[o]);
+                vector<char> had(reductions.size(), 0);
+                auto row = table.ACTION.find(i);
+                if (row != table.ACTION.end()) {
+                    for (const auto& a : row->second) {
+                        if (a.second.type != 'r') continue;
+                        auto pos = find(reductions.begin(), reductions.end(), a.second.value);
+                        if (pos == reductions.end()) cols.push_back(a.first);
+                        else had[pos - reductions.begin()] = 1;
+                    }
+                }
+                for (size_t k = 0; k < reductions.size(); ++k) {
+                    const set<string>& la = *follow_set[lhs[reductions[k]]];
+                    if (!had[k]) cols.insert(cols.end(), la.begin(), la.end());
+                }
+            }
+            for (int p : reductions) {
+                int A = lhs[p];
+                if (!follow_changed[A]) continue;
+                cols.insert(cols.end(), follow_added[A].begin(), follow_added[A].end());
+                cols.insert(cols.end(), follow_removed[A].begin(), follow_removed[A].end());
+            }
+            fresh = !patch_row(i, reductions, accepts, cols);
+        }
+        if (!fresh) {
+            ++st.patched_rows;
+            continue;
+        }
+        table.ACTION.erase(i);
+        table.GOTO.erase(i);
+        add_reduce_actions(g, cc, i, follow_of, table);
+        add_shift_goto_actions(g, cc, i, table);
+    }
+    return st;
+}
+
+// 判断两组结果是否描述同一个自动机：从状态0出发按转移建立状态对应，再逐个比较项目集和分析表行。
+// 两者须基于同一个文法（产生式编号一致）。
+bool equivalent_tables(const CanonicalCollection& a_cc, const SLRTable& a,
+                       const CanonicalCollection& b_cc, const SLRTable& b) {
+    int n = a_cc.C.size();
+    if (n != (int)b_cc.C.size() || a_cc.transitions.size() != b_cc.transitions.size()) return false;
+    vector<int> to_b(n, -1);
+    vector<int> queue = {0};
+    to_b[0] = 0;
+    for (size_t q = 0; q < queue.size(); ++q) {
+        int s = queue[q];
+        auto ia = a_cc.transitions.lower_bound({s, string()});
+        auto ib = b_cc.transitions.lower_bound({to_b[s], string()});
+        for (; ia != a_cc.transitions.end() && ia->first.first == s; ++ia, ++ib) {
+            if (ib == b_cc.transitions.end() || ib->first.first != to_b[s] || ib->first.second != ia->first.second) return false;
+            if (to_b[ia->second] < 0) {
+                to_b[ia->second] = ib->second;
+                queue.push_back(ia->second);
+            } else if (to_b[ia->second] != ib->second) {
+                return false;
+            }
+        }
+        if (ib != b_cc.transitions.end() && ib->first.first == to_b[s]) return false;
+    }
+    if ((int)queue.size() != n) return false;
+
+    static const map<string, SLRAction> no_actions;
+    static const map<string, int> no_gotos;
+    for (int s = 0; s < n; ++s) {
+        int t = to_b[s];
+        if (!(a_cc.C[s] == b_cc.C[t])) return false;
+        auto ra = a.ACTION.find(s), rb = b.ACTION.find(t);
+        const auto& aa = ra == a.ACTION.end() ? no_actions : ra->second;
+        const auto& ab = rb == b.ACTION.end() ? no_actions : rb->second;
+        if (aa.size() != ab.size()) return false;
+        for (const auto& e : aa) {
+            auto f = ab.find(e.first);
+            if (f == ab.end()) return false;
+            SLRAction expect = e.second;
+            if (expect.type == 's') expect.value = to_b[expect.value];
+            if (f->second != expect) return false;
+        }
+        auto ga = a.GOTO.find(s), gb = b.GOTO.find(t);
+        const auto& xa = ga == a.GOTO.end() ? no_gotos : ga->second;
+        const auto& xb = gb == b.GOTO.end() ? no_gotos : gb->second;
+        if (xa.size() != xb.size()) return false;
+        for (const auto& e : xa) {
+            auto f = xb.find(e.first);
+            if (f == xb.end() || f->second != to_b[e.second]) return false;
+        }
+    }
+    return true;
+}
+
+// ===== 运行时分析表 =====
+// 动作编码为int16_t：0 表示出错；v > 0 表示移进到状态 v-1；v < 0 表示按产生式 -v-1 归约，
+// 其中按产生式0（S' → S）归约即为接受。GOTO表中 -1 表示无转移。
+inline int16_t encode_action(const SLRAction& act) {
+    if (act.type == 's') return (int16_t)(act.value + 1);
+    if (act.type == 'r') return (int16_t)(-act.value - 1);
+    if (act.type == 'a') return -1;
+    return 0;
+}
+
+// 移进目标编码为状态号+1，归约编码为-(产生式编号+1)，压缩表的check数组还要存状态号（-1表示空闲），
+// 因此状态数和产生式数都不能超过 INT16_MAX，否则编码会回绕。超出时直接报错。
+const int PARSE_TABLE_MAX_STATES = INT16_MAX;
+const int PARSE_TABLE_MAX_PRODUCTIONS = INT16_MAX;
+
+inline void check_parse_table_limits(size_t state_count, size_t production_count) {
+    if (state_count > (size_t)PARSE_TABLE_MAX_STATES) {
+        throw length_error("分析表状态数 " + to_string(state_count) + " 超过上限 " +
+                           to_string(PARSE_TABLE_MAX_STATES));
+    }
+    if (production_count > (size_t)PARSE_TABLE_MAX_PRODUCTIONS) {
+        throw length_error("产生式数 " + to_string(production_count) + " 超过上限 " +
+                           to_string(PARSE_TABLE_MAX_PRODUCTIONS));
+    }
+}
+
+inline SLRAction decode_action(int16_t v) {
+    if (v > 0) return {'s', v - 1};
+    if (v == -1) return {'a', 0};
+    if (v < 0) return {'r', -v - 1};
+    return {'\0', 0};
+}
+
+// 只读的分析表数组：数据或由owner持有（运行时构造的表、映射的缓存文件），
+// 或直接指向程序中的常量数组（slr_table_gen生成的头文件），复制时只复制指针
+template <typename T>
+class TableArray {
+public:
+    TableArray() {}
+    explicit TableArray(vector<T> values) {
+        auto holder = make_shared<vector<T>>(move(values));
+        ptr = holder->data();
+        count = holder->size();
+        owner = move(holder);
+    }
+    template <size_t N>
+    explicit TableArray(const T (&values)[N]) : ptr(values), count(N) {}
+    TableArray(const T* data, size_t size, shared_ptr<const void> keep_alive = nullptr)
+        : owner(move(keep_alive)), ptr(data), count(size) {}
+
+    const T& operator[](size_t i) const { return ptr[i]; }
+    size_t size() const { return count; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+
+private:
+    shared_ptr<const void> owner;
+    const T* ptr = nullptr;
+    size_t count = 0;
+};
+
+// 符号编号与名称的双向查找：names按编号存放名称，order为按名称排序的编号，按名称查找时二分
+class SymbolIndex {
+public:
+    SymbolIndex() {}
+    // 运行时由名称列表构造，名称和排序结果都由自己持有
+    explicit SymbolIndex(const vector<string>& symbols) {
+        struct Storage {
+            vector<string> strings;
+            vector<const char*> names;
+        };
+        auto storage = make_shared<Storage>();
+        storage->strings = symbols;
+        for (const auto& name : storage->strings) storage->names.push_back(name.c_str());
+        names = TableArray<const char*>(storage->names.data(), storage->names.size(), storage);
+        vector<int32_t> sorted(symbols.size());
+        for (size_t i = 0; i < sorted.size(); ++i) sorted[i] = i;
+        sort(sorted.begin(), sorted.end(),
+             [&](int32_t a, int32_t b) { return strcmp(names[a], names[b]) < 0; });
+        order = TableArray<int32_t>(move(sorted));
+    }
+    // 直接使用外部的名称数组和排序数组
+    SymbolIndex(TableArray<const char*> names, TableArray<int32_t> order)
+        : names(move(names)), order(move(order)) {}
+
+    int size() const { return names.size(); }
+    const char* operator[](int id) const { return names[id]; }
+    const TableArray<int32_t>& sorted_ids() const { return order; }
+
+    // 按名称查编号，不存在时返回-1
+    int find(const string& name) const {
+        const int32_t* it = lower_bound(order.begin(), order.end(), name,
+                                        [&](int32_t id, const string& key) { return strcmp(names[id], key.c_str()) < 0; });
+        return (it != order.end() && name == names[*it]) ? *it : -1;
+    }
+    int at(const string& name) const {
+        int id = find(name);
+        if (id < 0) throw out_of_range("未知的文法符号: " + name);
+        return id;
+    }
+
+private:
+    TableArray<const char*> names;
+    TableArray<int32_t> order;
+};
+
+struct ParseTable {
+    int state_count = 0;
+    SymbolIndex terminals;           // 终结符编号 <-> 名称，最后一个为"#"
+    SymbolIndex nonterminals;        // 非终结符编号 <-> 名称
+
+    // 稠密形式：按 (状态, 符号编号) 直接下标，只在构造和压缩之间存在
+    vector<int16_t> action;          // [state * terminals.size() + t]
+    vector<int16_t> go;              // [state * nonterminals.size() + nt]
+    vector<char> keep_errors;        // 有 %nonassoc 出错表项的状态，压缩时不设默认归约
+
+    // 压缩形式：行位移（comb vector），每个状态另有一个默认归约。
+    // 压缩后不再修改，可以直接指向生成的头文件或映射的缓存文件中的数组
+    bool compressed = false;
+    TableArray<int16_t> default_action;  // 每个状态的默认归约（编码后），0 表示无
+    TableArray<int32_t> action_base;
+    TableArray<int16_t> action_value;
+    TableArray<int16_t> action_check;    // 该格属于哪个状态，-1 表示空闲
+    TableArray<int16_t> default_goto;    // 每个非终结符最常见的GOTO目标
+    TableArray<int32_t> goto_base;
+    TableArray<int16_t> goto_value;
+    TableArray<int16_t> goto_check;
+
+    // 只做一种归约、没有移进和GOTO的状态 -> 该产生式编号，其余为-1；由稠密表求出，压缩后保留
+    TableArray<int16_t> sole_reduction;
+    // 单产生式消除：状态按可跳过的单产生式归约时为其左部编号，否则为-1；为空时不消除
+    vector<int> unit_lhs;
+
+    int terminal_count() const { return terminals.size(); }
+    int nonterminal_count() const { return nonterminals.size(); }
+
+    // 查ACTION表，含默认归约
+    int16_t action_at(int state, int t) const {
+        if (!compressed) return action[state * terminals.size() + t];
+        int i = action_base[state] + t;
+        if (action_check[i] == state) return action_value[i];
+        return default_action[state];
+    }
+
+    // 查GOTO表；合法的LR分析过程只会查询有定义的表项，因此未命中时直接返回该列的默认值。
+    // 启用了单产生式消除时，目标状态若只做可跳过的归约 A → B，直接转到 GOTO(state, A)，
+    // skipped非空时累加由此省去的归约次数
+    int goto_at(int state, int nt, size_t* skipped = nullptr) const {
+        int target = raw_goto_at(state, nt);
+        if (unit_lhs.empty() || target < 0 || unit_lhs[target] < 0) return target;
+        return bypass_unit_states(state, target, skipped);
+    }
+
+    int raw_goto_at(int state, int nt) const {
+        if (!compressed) return go[state * nonterminals.size() + nt];
+        int i = goto_base[state] + nt;
+        if (goto_check[i] == state) return goto_value[i];
+        return default_goto[nt];
+    }
+
+    void compress();
+    int eliminate_unit_reductions(const vector<int>& production_lhs, const vector<char>& bypass);
+
+private:
+    int bypass_unit_states(int state, int target, size_t* skipped) const;
+};
+
+// 把一组稀疏行用首次适配的方式叠放到一个梳状数组中
+// rows[s]为状态s按列号升序的(列, 值)表项；返回每行的基址，并填充value/check
+static void pack_rows(const vector<vector<pair<int, int16_t>>>& rows, int width,
+                      vector<int32_t>& base, vector<int16_t>& value, vector<int16_t>& check) {
+    base.assign(rows.size(), 0);
+    value.assign(width, 0);
+    check.assign(width, -1);
+
+    // 表项多的行先放，更容易找到空位
+    vector<int> order(rows.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    stable_sort(order.begin(), order.end(),
+                [&](int a, int b) { return rows[a].size() > rows[b].size(); });
+
+    // lowest_free之前的格都已占用：行的第一个表项（列号最小）至少要落在这里，
+    // 首次适配从对应的基址开始找，不必每行都从0重新扫描
+    size_t lowest_free = 0;
+    for (int s : order) {
+        const auto& row = rows[s];
+        if (row.empty()) continue;
+        int b = max(0, (int)lowest_free - row.front().first);
+        while (true) {
+            bool fits = true;
+            for (const auto& e : row) {
+                size_t i = b + e.first;
+                if (i < check.size() && check[i] != -1) { fits = false; break; }
+            }
+            if (fits) break;
+            ++b;
+        }
+        base[s] = b;
+        size_t need = b + width;
+        if (check.size() < need) {
+            value.resize(need, 0);
+            check.resize(need, -1);
+        }
+        for (const auto& e : row) {
+            value[b + e.first] = e.second;
+            check[b + e.first] = (int16_t)s;   // 状态数已由 check_parse_table_limits 限制，不会与-1混淆
+        }
+        while (lowest_free < check.size() && check[lowest_free] != -1) ++lowest_free;
+    }
+}
+
+void ParseTable::compress() {
+    if (compressed) return;
+    int T = terminal_count(), N = nonterminal_count();
+    vector<int32_t> base;
+    vector<int16_t> value, check;
+
+    // ACTION：每个状态出现最多的归约作为默认动作，不再占用梳状数组。
+    // 有 %nonassoc 出错表项的状态不设默认归约（同bison），否则出错格会被默认归约填上，
+    // 如 a < b < c 会先归约再移进第二个 <，不可结合的声明就失效了
+    vector<int16_t> defaults(state_count, 0);
+    vector<vector<pair<int, int16_t>>> rows(state_count);
+    for (int s = 0; s < state_count; ++s) {
+        bool keep = !keep_errors.empty() && keep_errors[s];
+        map<int16_t, int> reduce_count;
+        for (int t = 0; t < T; ++t) {
+            int16_t v = action[s * T + t];
+            if (v < -1 && !keep) reduce_count[v]++;   // 接受不作为默认动作
+        }
+        int best = 0;
+        for (const auto& rc : reduce_count) {
+            if (rc.second > best) {
+                best = rc.second;
+                defaults[s] = rc.first;
+            }
+        }
+        for (int t = 0; t < T; ++t) {
+            int16_t v = action[s * T + t];
+            if (v != 0 && v != defaults[s]) rows[s].push_back({t, v});
+        }
+    }
+    pack_rows(rows, T, base, value, check);
+    default_action = TableArray<int16_t>(move(defaults));
+    action_base = TableArray<int32_t>(move(base));
+    action_value = TableArray<int16_t>(move(value));
+    action_check = TableArray<int16_t>(move(check));
+
+    // GOTO：每个非终结符最常见的目标作为该列默认值；按行扫描稠密表，避免逐列跨行访问
+    vector<int16_t> goto_defaults(N, -1);
+    vector<map<int16_t, int>> target_counts(N);
+    for (int s = 0; s < state_count; ++s) {
+        for (int nt = 0; nt < N; ++nt) {
+            int16_t v = go[(size_t)s * N + nt];
+            if (v >= 0) target_counts[nt][v]++;
+        }
+    }
+    for (int nt = 0; nt < N; ++nt) {
+        int best = 0;
+        for (const auto& tc : target_counts[nt]) {
+            if (tc.second > best) {
+                best = tc.second;
+                goto_defaults[nt] = tc.first;
+            }
+        }
+    }
+    vector<vector<pair<int, int16_t>>> goto_rows(state_count);
+    for (int s = 0; s < state_count; ++s) {
+        for (int nt = 0; nt < N; ++nt) {
+            int16_t v = go[s * N + nt];
+            if (v >= 0 && v != goto_defaults[nt]) goto_rows[s].push_back({nt, v});
+        }
+    }
+    pack_rows(goto_rows, N, base, value, check);
+    default_goto = TableArray<int16_t>(move(goto_defaults));
+    goto_base = TableArray<int32_t>(move(base));
+    goto_value = TableArray<int16_t>(move(value));
+    goto_check = TableArray<int16_t>(move(check));
+
+    compressed = true;
+    action.clear();
+    action.shrink_to_fit();
+    go.clear();
+    go.shrink_to_fit();
+}
+
+// 单产生式消除：若 GOTO(s, B) 到达的状态 t 只做一种归约 A → B，分析器在 t 中必然归约并转到 GOTO(s, A)。
+// 当该产生式的语义动作只是把唯一的子节点原样传上去时（bypass[p]为真），查 GOTO(s, B) 时直接给出 GOTO(s, A)，
+// 省掉这次归约；A 的GOTO目标若仍是这样的状态则继续沿链走。t 在其他输入上只会报错，
+// 跳过后的错误会在下一个移进前被发现。表本身不改写，稠密和压缩形式（包括外部的只读数组）都适用。
+// 返回归约会被跳过的状态数。
+int ParseTable::eliminate_unit_reductions(const vector<int>& production_lhs, const vector<char>& bypass) {
+    unit_lhs.assign(state_count, -1);
+    int bypassed = 0;
+    for (int t = 0; t < state_count; ++t) {
+        int p = sole_reduction[t];
+        if (p >= 0 && p < (int)bypass.size() && bypass[p]) {
+            unit_lhs[t] = production_lhs[p];
+            ++bypassed;
+        }
+    }
+    if (bypassed == 0) unit_lhs.clear();
+    return bypassed;
+}
+
+// 沿单产生式链走，步数以状态数为上限；链上缺少GOTO项时保留原目标
+int ParseTable::bypass_unit_states(int state, int target, size_t* skipped) const {
+    int next = target, steps = 0;
+    for (; next >= 0 && unit_lhs[next] >= 0 && steps < state_count; ++steps) {
+        next = raw_goto_at(state, unit_lhs[next]);
+    }
+    if (next < 0) return target;
+    if (skipped) *skipped += steps;
+    return next;
+}
+
+// 由SLR分析表生成稠密的运行时分析表
+ParseTable build_parse_table(const Grammar& g, const SLRTable& table, int state_count) {
+    check_parse_table_limits(state_count, g.productions.size());
+    ParseTable pt;
+    pt.state_count = state_count;
+    vector<string> terminals(g.terminals.begin(), g.terminals.end());
+    terminals.push_back("#");
+    pt.terminals = SymbolIndex(terminals);
+    pt.nonterminals = SymbolIndex(vector<string>(g.nonterminals.begin(), g.nonterminals.end()));
+
+    int T = pt.terminal_count(), N = pt.nonterminal_count();
+    pt.action.assign((size_t)state_count * T, 0);
+    pt.go.assign((size_t)state_count * N, -1);
+    for (const auto& row : table.ACTION) {
+        for (const auto& cell : row.second) {
+            int t = pt.terminals.find(cell.first);
+            if (t >= 0 && !cell.second.empty()) {
+                pt.action[(size_t)row.first * T + t] = encode_action(cell.second);
+            }
+        }
+    }
+    for (const auto& row : table.GOTO) {
+        for (const auto& cell : row.second) {
+            pt.go[(size_t)row.first * N + pt.nonterminals.at(cell.first)] = cell.second;
+        }
+    }
+
+    pt.keep_errors.assign(state_count, 0);
+    for (int s : table.error_states) pt.keep_errors[s] = 1;
+
+    // 只做一种归约（不含接受）、没有移进和GOTO的状态，供单产生式消除使用；
+    // 有 %nonassoc 出错表项的状态不能跳过，否则出错检查也被跳过
+    vector<int16_t> sole(state_count, -1);
+    for (int s = 0; s < state_count; ++s) {
+        int16_t only = 0;
+        bool pure = !pt.keep_errors[s];
+        for (int t = 0; t < T && pure; ++t) {
+            int16_t code = pt.action[(size_t)s * T + t];
+            if (code == 0) continue;
+            if (code > 0 || code == -1 || (only != 0 && code != only)) pure = false;
+            only = code;
+        }
+        for (int nt = 0; nt < N && pure; ++nt) {
+            if (pt.go[(size_t)s * N + nt] >= 0) pure = false;
+        }
+        if (pure && only != 0) sole[s] = -only - 1;
+    }
+    pt.sole_reduction = TableArray<int16_t>(move(sole));
+    return pt;
+}
+
+void print_parse_table_stats(const ParseTable& pt) {
+    size_t dense_cells = (size_t)pt.state_count * (pt.terminal_count() + pt.nonterminal_count());
+    cout << "\n=== 运行时分析表 ===" << endl;
+    cout << "状态数: " << pt.state_count << ", 终结符数: " << pt.terminal_count()
+         << ", 非终结符数: " << pt.nonterminal_count() << endl;
+    cout << "稠密表格数: " << dense_cells << " (" << dense_cells * sizeof(int16_t) << " 字节)" << endl;
+    if (pt.compressed) {
+        size_t packed = pt.action_value.size() + pt.goto_value.size();
+        size_t bytes = packed * 2 * sizeof(int16_t)
+                     + (pt.action_base.size() + pt.goto_base.size()) * sizeof(int32_t)
+                     + (pt.default_action.size() + pt.default_goto.size()) * sizeof(int16_t);
+        int defaults = 0;
+        for (auto d : pt.default_action) if (d != 0) defaults++;
+        cout << "压缩后梳状数组格数: " << packed << " (共 " << bytes << " 字节)"
+             << ", 含默认归约的状态数: " << defaults << endl;
+    }
+}
+
+// ===== 按需构造的SLR(1)分析表 =====
+// 开始时只构造初始状态；分析器第一次查询某个状态时，才求它的闭包、出边和ACTION/GOTO行并记下来，
+// 出边指向的新状态此时只登记内核。符号编号与 build_parse_table 相同，动作编码同 ParseTable，
+// 填表规则同 build_slr_table（先归约后移进，移进-归约冲突按优先级裁决），状态按首次到达的顺序编号。
+class LazySLRTable {
+public:
+    vector<string> terminals;        // 终结符编号 -> 名称，最后一个为"#"
+    vector<string> nonterminals;     // 非终结符编号 -> 名称
+
+    // grammar须已计算FOLLOW集
+    explicit LazySLRTable(const Grammar& grammar) : g(grammar) {
+        terminals.assign(g.terminals.begin(), g.terminals.end());
+        terminals.push_back("#");
+        nonterminals.assign(g.nonterminals.begin(), g.nonterminals.end());
+        map<string, int> terminal_id;
+        for (size_t i = 0; i < terminals.size(); ++i) terminal_id[terminals[i]] = i;
+        follow_ids.resize(g.nonterminal_count);
+        for (int nt = 0; nt < g.nonterminal_count; ++nt) {
+            for (const auto& a : g.follow.at(nonterminals[nt])) follow_ids[nt].push_back(terminal_id.at(a));
+        }
+        intern({Item(0, 0)});
+        expand(0);
+    }
+
+    int16_t action_at(int state, int t) { return row(state).action[t]; }
+    int goto_at(int state, int nt) { return row(state).go[nt]; }
+
+    int state_count() const { return kernels.size(); }   // 已发现的状态数
+    int expanded_count() const { return expanded; }      // 已构造出分析表行的状态数
+
+private:
+    struct Row {
+        bool ready = false;
+        vector<int16_t> action;
+        vector<int16_t> go;
+    };
+
+    Grammar g;
+    vector<vector<int>> follow_ids;  // 非终结符编号 -> FOLLOW集中的终结符编号
+    vector<vector<Item>> kernels;
+    map<vector<Item>, int> kernel_id;
+    vector<Row> rows;
+    int expanded = 0;
+
+    const Row& row(int state) {
+        if (!rows[state].ready) expand(state);
+        return rows[state];
+    }
+
+    int intern(vector<Item> kernel) {
+        auto found = kernel_id.find(kernel);
+        if (found != kernel_id.end()) return found->second;
+        int id = kernels.size();
+        check_parse_table_limits(id + 1, g.productions.size());
+        kernels.push_back(kernel);
+        kernel_id.emplace(move(kernel), id);
+        rows.emplace_back();
+        return id;
+    }
+
+    void expand(int state) {
+        ItemSet I = closure(kernels[state], g);
+        int T = terminals.size(), ntc = g.nonterminal_count;
+        Row r;
+        r.action.assign(T, 0);
+        r.go.assign(ntc, -1);
+
+        // 归约/接受
+        for (const auto& item : I.items) {
+            int p = item.production_id();
+            if (item.dot_pos() < (int)g.rhs_ids[p].size()) continue;
+            if (p == 0) {
+                r.action[T - 1] = encode_action({'a', 0});
+                continue;
+            }
+            int16_t code = encode_action({'r', p});
+            for (int t : follow_ids[g.symbol_id.at(g.productions[p].left)]) r.action[t] = code;
+        }
+
+        // 移进和GOTO，新状态在这里只登记内核
+        for (auto& k : goto_kernels(I, g)) {
+            int target = intern(move(k.second));
+            if (k.first < ntc) {
+                r.go[k.first] = target;
+                continue;
+            }
+            int t = k.first - ntc;
+            int16_t& cell = r.action[t];
+            SLRAction existing = decode_action(cell);
+            if (existing.type == 'r') {
+                char decision = resolve_shift_reduce(g, existing.value, terminals[t]);
+                if (decision == 'r') continue;
+                if (decision == 'e') {
+                    cell = 0;
+                    continue;
+                }
+            }
+            cell = encode_action({'s', target});
+        }
+
+        r.ready = true;
+        rows[state] = move(r);
+        ++expanded;
+    }
+};
+
+// ===== 分析表二进制缓存 =====
+// 以规范化后的文法文本的哈希为键，把符号表、产生式、项目集规范族的状态转移、
+// SLR分析表和压缩后的运行时分析表写入一个二进制文件；下次遇到相同文法时mmap该文件。
+// 分析器只读文法和运行时分析表，运行时分析表的数组直接指向映射的内存，映射随分析表保留；
+// lr0 的 --cache 需要完整的SLR分析表，才从稠密表重建。
+// 文件布局（本机字节序）：
+//   魔数"SLRC" | 版本 | 文法哈希 | 运行时分析表的偏移 | 规范化文法文本
+//   符号表（非终结符在前）| 产生式（左部编号, 右部编号列表）
+//   状态数 | 状态转移三元组(状态, 符号, 目标) | ACTION稠密表 | GOTO稠密表 | 冲突信息
+//   | 有 %nonassoc 出错表项的状态
+//   运行时分析表：状态数、终结符数、非终结符数、两个梳状数组的长度 | 终结符和非终结符名称（以\0结尾）
+//   | 名称排序数组 | 默认动作、基址、value、check | 默认GOTO、基址、value、check | 单一归约
+//   运行时分析表中的每个数组都按4字节对齐
+const uint32_t TABLE_CACHE_MAGIC = 0x43524C53;  // "SLRC"
+const uint32_t TABLE_CACHE_VERSION = 4;
+
+// 规范化文法文本：统一箭头写法，合并连续空白，去掉空规则
+string normalize_rules(const vector<string>& rules) {
+    string text;
+    for (string rule : rules) {
+        size_t arrow = rule.find("→");
+        if (arrow != string::npos) rule.replace(arrow, strlen("→"), "->");
+        stringstream ss(rule);
+        string word, line;
+        while (ss >> word) line += (line.empty() ? "" : " ") + word;
+        if (!line.empty()) text += line + "\n";
+    }
+    return text;
+}
+
+// 64位FNV-1a哈希
+uint64_t hash_rules(const string& normalized) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : normalized) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+string table_cache_path(const string& cache_dir, uint64_t hash) {
+    ostringstream path;
+    path << cache_dir << "/slr-" << hex << setw(16) << setfill('0') << hash << ".tbl";
+    return path.str();
+}
+
+class CacheWriter {
+public:
+    string buf;
+
+    void u32(uint32_t v) { buf.append((const char*)&v, sizeof(v)); }
+    void u64(uint64_t v) { buf.append((const char*)&v, sizeof(v)); }
+    void i32(int32_t v) { buf.append((const char*)&v, sizeof(v)); }
+    void str(const string& s) {
+        u32(s.size());
+        buf.append(s);
+    }
+    void cstr(const char* s) { buf.append(s, strlen(s) + 1); }
+    void align() { buf.append((4 - buf.size() % 4) % 4, '\0'); }
+    template <typename Values>
+    void array(const Values& values) {
+        align();
+        for (auto v : values) buf.append((const char*)&v, sizeof(v));
+    }
+    void patch_u64(size_t pos, uint64_t v) { memcpy(&buf[pos], &v, sizeof(v)); }
+};
+
+// 直接在mmap得到的内存上读取，任何越界都视为缓存损坏
+class CacheReader {
+public:
+    const char* begin;
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    CacheReader(const char* data, size_t size) : begin(data), p(data), end(data + size) {}
+
+    template <typename T>
+    T read() {
+        T v = T();
+        if (end - p < (ptrdiff_t)sizeof(T)) { ok = false; return v; }
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    string str() {
+        uint32_t n = read<uint32_t>();
+        if (!ok || end - p < (ptrdiff_t)n) { ok = false; return ""; }
+        string s(p, n);
+        p += n;
+        return s;
+    }
+    const char* cstr() {
+        const char* nul = ok ? (const char*)memchr(p, '\0', end - p) : nullptr;
+        if (!nul) { ok = false; return ""; }
+        const char* s = p;
+        p = nul + 1;
+        return s;
+    }
+    void seek(uint64_t offset) {
+        if (offset > (uint64_t)(end - begin)) ok = false;
+        else p = begin + offset;
+    }
+    // 返回指向映射内存的数组，与 CacheWriter::array 一样先按4字节对齐
+    template <typename T>
+    const T* array(size_t n) {
+        p += (4 - (p - begin) % 4) % 4;
+        if (p > end || (size_t)(end - p) / sizeof(T) < n) { ok = false; return nullptr; }
+        const T* a = (const T*)p;
+        p += n * sizeof(T);
+        return a;
+    }
+};
+
+// 只读映射整个文件，最后一个引用释放时解除映射；文件不存在或为空时返回空指针
+static shared_ptr<const char> map_file(const string& path, size_t& size) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    size = st.st_size;
+    return shared_ptr<const char>((const char*)data, [size](const char* p) { munmap((void*)p, size); });
+}
+
+// 逐级创建目录（mkdir -p），已存在的目录跳过；失败时返回false，errno给出原因
+bool make_directories(const string& dir) {
+    for (size_t pos = 0; pos != string::npos;) {
+        pos = dir.find('/', pos + 1);
+        string prefix = dir.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0) return false;
+    if (!S_ISDIR(st.st_mode)) {
+        errno = ENOTDIR;
+        return false;
+    }
+    return true;
+}
+
+static void write_packed_table(CacheWriter& w, const ParseTable& pt) {
+    w.align();
+    w.u32(pt.state_count);
+    w.u32(pt.terminal_count());
+    w.u32(pt.nonterminal_count());
+    w.u32(pt.action_value.size());
+    w.u32(pt.goto_value.size());
+    for (int t = 0; t < pt.terminal_count(); ++t) w.cstr(pt.terminals[t]);
+    for (int nt = 0; nt < pt.nonterminal_count(); ++nt) w.cstr(pt.nonterminals[nt]);
+    w.array(pt.terminals.sorted_ids());
+    w.array(pt.nonterminals.sorted_ids());
+    w.array(pt.default_action);
+    w.array(pt.action_base);
+    w.array(pt.action_value);
+    w.array(pt.action_check);
+    w.array(pt.default_goto);
+    w.array(pt.goto_base);
+    w.array(pt.goto_value);
+    w.array(pt.goto_check);
+    w.array(pt.sole_reduction);
+}
+
+// pt为 build_parse_table 得到的稠密表：先写稠密表，压缩后再写运行时分析表
+bool save_table_cache(const string& path, const string& normalized, const Grammar& g,
+                      const CanonicalCollection& cc, const SLRTable& table, ParseTable& pt) {
+    CacheWriter w;
+    w.u32(TABLE_CACHE_MAGIC);
+    w.u32(TABLE_CACHE_VERSION);
+    w.u64(hash_rules(normalized));
+    size_t packed_offset_pos = w.buf.size();
+    w.u64(0);
+    w.str(normalized);
+
+    w.u32(g.symbols.size());
+    w.u32(g.nonterminal_count);
+    for (const auto& sym : g.symbols) w.str(sym);
+    w.u32(g.productions.size());
+    for (size_t p = 0; p < g.productions.size(); ++p) {
+        w.i32(g.symbol_id.at(g.productions[p].left));
+        w.u32(g.rhs_ids[p].size());
+        for (int id : g.rhs_ids[p]) w.i32(id);
+    }
+
+    w.u32(cc.C.size());
+    w.u32(cc.transitions.size());
+    for (const auto& tran : cc.transitions) {
+        w.i32(tran.first.first);
+        w.i32(g.symbol_id.at(tran.first.second));
+        w.i32(tran.second);
+    }
+    w.array(pt.action);
+    w.array(pt.go);
+    w.u32(table.conflicts.size());
+    for (const auto& c : table.conflicts) w.str(c);
+    w.u32(table.resolved.size());
+    for (const auto& c : table.resolved) w.str(c);
+    w.u32(table.error_states.size());
+    for (int s : table.error_states) w.i32(s);
+
+    pt.compress();
+    w.align();
+    w.patch_u64(packed_offset_pos, w.buf.size());
+    write_packed_table(w, pt);
+
+    // 先写临时文件再改名，避免其他进程读到写了一半的缓存
+    string tmp = path + ".tmp" + to_string(getpid());
+    ofstream out(tmp, ios::binary);
+    if (!out) return false;
+    out.write(w.buf.data(), w.buf.size());
+    out.close();
+    if (!out || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 读文件头和文法（符号表、产生式，不含FIRST/FOLLOW集），文法文本不一致时失败
+static bool read_cached_grammar(CacheReader& r, const string& normalized, Grammar& loaded,
+                                vector<string>& symbols, uint64_t& packed_offset) {
+    if (r.read<uint32_t>() != TABLE_CACHE_MAGIC || r.read<uint32_t>() != TABLE_CACHE_VERSION
+        || r.read<uint64_t>() != hash_rules(normalized)) {
+        return false;
+    }
+    packed_offset = r.read<uint64_t>();
+    if (r.str() != normalized) return false;
+
+    uint32_t symbol_count = r.read<uint32_t>();
+    uint32_t nonterminal_count = r.read<uint32_t>();
+    for (uint32_t i = 0; i < symbol_count && r.ok; ++i) symbols.push_back(r.str());
+    for (uint32_t i = 0; i < symbols.size(); ++i) {
+        if (i < nonterminal_count) loaded.nonterminals.insert(symbols[i]);
+        else loaded.terminals.insert(symbols[i]);
+    }
+    uint32_t production_count = r.read<uint32_t>();
+    for (uint32_t p = 0; p < production_count && r.ok; ++p) {
+        Production prod;
+        int32_t left = r.read<int32_t>();
+        uint32_t length = r.read<uint32_t>();
+        for (uint32_t j = 0; j < length && r.ok; ++j) {
+            int32_t id = r.read<int32_t>();
+            if (id < 0 || id >= (int32_t)symbols.size()) r.ok = false;
+            else prod.right.push_back(symbols[id]);
         }
+        if (left < 0 || left >= (int32_t)min<size_t>(nonterminal_count, symbols.size())) r.ok = false;
+        else prod.left = symbols[left];
+        loaded.productions.push_back(prod);
+    }
+    if (!r.ok || loaded.productions.empty()) return false;
+    loaded.start_symbol = loaded.productions[0].left;
+    loaded.build_index();
+    return true;
+}
+
+// 在映射的内存上建立运行时分析表，数组不复制；mapping随分析表保留。
+// 只检查下标不会越界，不检查表的内容
+static bool read_packed_table(CacheReader& r, const shared_ptr<const char>& mapping,
+                              int production_count, ParseTable& pt) {
+    uint32_t S = r.read<uint32_t>(), T = r.read<uint32_t>(), N = r.read<uint32_t>();
+    uint32_t action_size = r.read<uint32_t>(), goto_size = r.read<uint32_t>();
+    if (!r.ok || S == 0 || T == 0 || N == 0 || S > (uint32_t)PARSE_TABLE_MAX_STATES) return false;
+
+    struct Names {
+        vector<const char*> names;
+        shared_ptr<const char> mapping;
+    };
+    auto terminal_names = make_shared<Names>(), nonterminal_names = make_shared<Names>();
+    terminal_names->mapping = nonterminal_names->mapping = mapping;
+    for (uint32_t t = 0; t < T && r.ok; ++t) terminal_names->names.push_back(r.cstr());
+    for (uint32_t nt = 0; nt < N && r.ok; ++nt) nonterminal_names->names.push_back(r.cstr());
+    const int32_t* terminal_order = r.array<int32_t>(T);
+    const int32_t* nonterminal_order = r.array<int32_t>(N);
+    const int16_t* default_action = r.array<int16_t>(S);
+    const int32_t* action_base = r.array<int32_t>(S);
+    const int16_t* action_value = r.array<int16_t>(action_size);
+    const int16_t* action_check = r.array<int16_t>(action_size);
+    const int16_t* default_goto = r.array<int16_t>(N);
+    const int32_t* goto_base = r.array<int32_t>(S);
+    const int16_t* goto_value = r.array<int16_t>(goto_size);
+    const int16_t* goto_check = r.array<int16_t>(goto_size);
+    const int16_t* sole_reduction = r.array<int16_t>(S);
+    if (!r.ok) return false;
+
+    for (uint32_t i = 0; i < T; ++i) if (terminal_order[i] < 0 || terminal_order[i] >= (int32_t)T) return false;
+    for (uint32_t i = 0; i < N; ++i) if (nonterminal_order[i] < 0 || nonterminal_order[i] >= (int32_t)N) return false;
+    for (uint32_t s = 0; s < S; ++s) {
+        if (action_base[s] < 0 || (uint64_t)action_base[s] + T > action_size) return false;
+        if (goto_base[s] < 0 || (uint64_t)goto_base[s] + N > goto_size) return false;
+        if (sole_reduction[s] >= production_count) return false;
     }
 
+    pt = ParseTable();
+    pt.state_count = S;
+    pt.terminals = SymbolIndex(TableArray<const char*>(terminal_names->names.data(), T, terminal_names),
+                               TableArray<int32_t>(terminal_order, T, mapping));
+    pt.nonterminals = SymbolIndex(TableArray<const char*>(nonterminal_names->names.data(), N, nonterminal_names),
+                                  TableArray<int32_t>(nonterminal_order, N, mapping));
+    pt.compressed = true;
+    pt.default_action = TableArray<int16_t>(default_action, S, mapping);
+    pt.action_base = TableArray<int32_t>(action_base, S, mapping);
+    pt.action_value = TableArray<int16_t>(action_value, action_size, mapping);
+    pt.action_check = TableArray<int16_t>(action_check, action_size, mapping);
+    pt.default_goto = TableArray<int16_t>(default_goto, N, mapping);
+    pt.goto_base = TableArray<int32_t>(goto_base, S, mapping);
+    pt.goto_value = TableArray<int16_t>(goto_value, goto_size, mapping);
+    pt.goto_check = TableArray<int16_t>(goto_check, goto_size, mapping);
+    pt.sole_reduction = TableArray<int16_t>(sole_reduction, S, mapping);
+    return true;
+}
+
+// 从缓存文件重建文法（不含FIRST/FOLLOW集）、状态转移和SLR分析表
+// 文件不存在、损坏或文法文本不一致时返回false
+bool load_table_cache(const string& path, const string& normalized, Grammar& g,
+                      CanonicalCollection& cc, SLRTable& table, int& state_count) {
+    size_t size = 0;
+    shared_ptr<const char> data = map_file(path, size);
+    if (!data) return false;
+
+    CacheReader r(data.get(), size);
+    Grammar loaded;
+    vector<string> symbols;
+    uint64_t packed_offset = 0;
+    if (!read_cached_grammar(r, normalized, loaded, symbols, packed_offset)) return false;
+
+    CanonicalCollection loaded_cc;
+    SLRTable loaded_table;
+    state_count = r.read<uint32_t>();
+    uint32_t transition_count = r.read<uint32_t>();
+    for (uint32_t i = 0; i < transition_count && r.ok; ++i) {
+        int32_t from = r.read<int32_t>();
+        int32_t sym = r.read<int32_t>();
+        int32_t to = r.read<int32_t>();
+        if (sym < 0 || sym >= (int32_t)symbols.size()) r.ok = false;
+        else loaded_cc.transitions[{from, symbols[sym]}] = to;
+    }
+
+    vector<string> terms(loaded.terminals.begin(), loaded.terminals.end());
+    terms.push_back("#");
+    vector<string> nterms(loaded.nonterminals.begin(), loaded.nonterminals.end());
+    const int16_t* action = r.ok ? r.array<int16_t>((size_t)state_count * terms.size()) : nullptr;
+    const int16_t* go = r.ok ? r.array<int16_t>((size_t)state_count * nterms.size()) : nullptr;
+    for (int s = 0; r.ok && s < state_count; ++s) {
+        for (size_t t = 0; t < terms.size(); ++t) {
+            int16_t v = action[(size_t)s * terms.size() + t];
+            if (v != 0) loaded_table.ACTION[s][terms[t]] = decode_action(v);
+        }
+        for (size_t nt = 0; nt < nterms.size(); ++nt) {
+            int16_t v = go[(size_t)s * nterms.size() + nt];
+            if (v >= 0) loaded_table.GOTO[s][nterms[nt]] = v;
+        }
+    }
+    uint32_t conflict_count = r.read<uint32_t>();
+    for (uint32_t i = 0; i < conflict_count && r.ok; ++i) loaded_table.conflicts.push_back(r.str());
+    uint32_t resolved_count = r.read<uint32_t>();
+    for (uint32_t i = 0; i < resolved_count && r.ok; ++i) loaded_table.resolved.push_back(r.str());
+    uint32_t error_count = r.read<uint32_t>();
+    for (uint32_t i = 0; i < error_count && r.ok; ++i) {
+        int32_t s = r.read<int32_t>();
+        if (s < 0 || s >= state_count) r.ok = false;
+        else loaded_table.error_states.insert(s);
+    }
+    if (!r.ok) return false;
+
+    g = loaded;
+    cc = loaded_cc;
+    table = loaded_table;
+    return true;
+}
+
+// 只载入文法和运行时分析表：跳过状态转移和稠密表，分析表直接使用映射的内存
+bool load_parse_table_cache(const string& path, const string& normalized, Grammar& g, ParseTable& pt) {
+    size_t size = 0;
+    shared_ptr<const char> data = map_file(path, size);
+    if (!data) return false;
+
+    CacheReader r(data.get(), size);
+    Grammar loaded;
+    vector<string> symbols;
+    uint64_t packed_offset = 0;
+    if (!read_cached_grammar(r, normalized, loaded, symbols, packed_offset)) return false;
+    r.seek(packed_offset);
+    ParseTable loaded_pt;
+    if (!r.ok || !read_packed_table(r, data, loaded.productions.size(), loaded_pt)) return false;
+
+    g = loaded;
+    pt = loaded_pt;
+    return true;
+}
+
+// 创建缓存目录（含各级父目录）并写入缓存，失败时给出警告；pt写入后被压缩
+static void store_table_cache(const string& cache_dir, const string& path, const string& normalized,
+                              const Grammar& g, const CanonicalCollection& cc, const SLRTable& table,
+                              ParseTable& pt) {
+    if (!make_directories(cache_dir)) {
+        cerr << "警告: 无法创建分析表缓存目录 " << cache_dir << ": " << strerror(errno) << endl;
+        pt.compress();
+        return;
+    }
+    if (!save_table_cache(path, normalized, g, cc, table, pt)) {
+        cerr << "警告: 无法写入分析表缓存 " << path << endl;
+    }
+}
+
+// 带缓存的分析表构造：命中时直接载入，否则完整构造后写入缓存
+// 返回true表示命中缓存；此时文法没有FIRST/FOLLOW集，cc中也只有状态转移
+bool build_tables_cached(const vector<string>& rules, const string& cache_dir, Grammar& g,
+                         CanonicalCollection& cc, SLRTable& table, int& state_count) {
+    string normalized = normalize_rules(rules);
+    string path = table_cache_path(cache_dir, hash_rules(normalized));
+    if (load_table_cache(path, normalized, g, cc, table, state_count)) {
+        DEBUG_PRINT(cout << "分析表缓存命中: " << path << endl);
+        return true;
+    }
+
+    g.parse(rules);
+    g.compute_first();
+    g.compute_follow();
+    cc = build_canonical_collection(g);
+    table = build_slr_table(g, cc);
+    state_count = cc.C.size();
+
+    ParseTable pt = build_parse_table(g, table, state_count);
+    store_table_cache(cache_dir, path, normalized, g, cc, table, pt);
+    DEBUG_PRINT(cout << "分析表缓存未命中，已重新构造: " << path << endl);
+    return false;
+}
+
+// 分析器用的带缓存构造，pt总是压缩形式。命中时pt直接指向映射的缓存文件，
+// 文法只有符号和产生式，slr为空；未命中时完整构造并写入缓存，slr为SLR分析表。
+// 返回true表示命中缓存
+bool build_parse_table_cached(const vector<string>& rules, const string& cache_dir, Grammar& g,
+                              ParseTable& pt, SLRTable& slr) {
+    string normalized = normalize_rules(rules);
+    string path = table_cache_path(cache_dir, hash_rules(normalized));
+    if (load_parse_table_cache(path, normalized, g, pt)) {
+        DEBUG_PRINT(cout << "分析表缓存命中: " << path << endl);
+        return true;
+    }
+
+    g.parse(rules);
+    g.compute_first();
+    g.compute_follow();
+    CanonicalCollection cc = build_canonical_collection(g);
+    slr = build_slr_table(g, cc);
+    pt = build_parse_table(g, slr, cc.C.size());
+    store_table_cache(cache_dir, path, normalized, g, cc, slr, pt);
+    DEBUG_PRINT(cout << "分析表缓存未命中，已重新构造: " << path << endl);
+    return false;
+}
+
+// 内置示例文法，编号即 --rules 的参数
+vector<vector<string>> builtin_grammars() {
     vector<string> rules0 = {
         //"S → E",
         "E → E + T | T",
@@ -721,6 +2945,8 @@ int main(int argc, char* argv[]) {
         "B → a B | b"
     };
     vector<string> rules4 = {
+        "%left +",
+        "%left *",
         "E → E + E | E * E | ( E ) | i"
     };   
     vector<string> rules5 = {
@@ -762,25 +2988,149 @@ int main(int argc, char* argv[]) {
         "Fact -> ID | ID LBRACK Expr RBRACK | INT_NUM | FLOAT_NUM | LPAR Expr RPAR",
         "ArgList -> ArgList COMMA Expr | Expr | ε"
     };
+
+    return {rules0, rules1, rules2, rules3, rules4, rules5, rules6};
+}
+
+#ifdef LR0_MAIN
+int main(int argc, char* argv[]) {
+    int rules_index = 6;
+    int thread_count = 1;
+    bool use_lalr = false;
+    string grammar_file, cache_dir, incremental_file;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--debug" || arg == "-d") {
+            DEBUG_MODE = true;
+        } else if (arg == "--rules" && i + 1 < argc) {
+            rules_index = atoi(argv[++i]);
+        } else if (arg == "--grammar" && i + 1 < argc) {
+            grammar_file = argv[++i];
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (arg == "--lalr") {
+            use_lalr = true;
+        } else if (arg == "--incremental" && i + 1 < argc) {
+            incremental_file = argv[++i];
+        }
+    }
+
+    vector<vector<string>> builtin_rules = builtin_grammars();
+    vector<string> rules;
+    if (!grammar_file.empty()) {
+        if (!read_grammar_rules(grammar_file, rules)) {
+            cerr << "无法打开文法文件: " << grammar_file << endl;
+            return 1;
+        }
+    } else if (rules_index >= 0 && rules_index < (int)builtin_rules.size()) {
+        rules = builtin_rules[rules_index];
+    } else {
+        cerr << "没有编号为 " << rules_index << " 的内置文法" << endl;
+        return 1;
+    }
     
     Grammar g;
-    g.parse(rules6);
-    
-    // 首先计算FIRST集
-    g.compute_first();
-    
-    // 然后计算FOLLOW集
-    g.compute_follow();
-    
-    g.print_grammar();
-    
-    // 构建LR(0)项目集规范族
-    CanonicalCollection cc = build_canonical_collection(g);
-    print_canonical_collection(cc, g);
+    CanonicalCollection cc;
+    SLRTable slr;
+    int state_count = 0;
+    if (!cache_dir.empty() && (use_lalr || !incremental_file.empty())) {
+        // 缓存命中时没有项目集，无法计算LALR(1)向前看符号，也无法增量重建
+        cout << "=== --lalr/--incremental 需要完整的项目集，忽略 --cache ===" << endl;
+        cache_dir.clear();
+    }
+    if (!cache_dir.empty()) {
+        // 使用分析表缓存：文法未变时跳过FIRST/FOLLOW、项目集和分析表的构造
+        bool hit = build_tables_cached(rules, cache_dir, g, cc, slr, state_count);
+        cout << "=== 分析表缓存" << (hit ? "命中" : "未命中，已重新构造") << ": "
+             << table_cache_path(cache_dir, hash_rules(normalize_rules(rules))) << " ===" << endl;
+        if (!hit) {
+            g.print_grammar();
+            print_canonical_collection(cc, g);
+        }
+        print_slr_table(slr, g, state_count);
+    } else {
+        g.parse(rules);
+        
+        // 首先计算FIRST集
+        g.compute_first();
+        
+        // 然后计算FOLLOW集
+        g.compute_follow();
+        
+        g.print_grammar();
+        
+        // 构建LR(0)项目集规范族，--threads大于1时按BFS层并行构造
+        cc = build_canonical_collection_parallel(g, thread_count);
+        print_canonical_collection(cc, g);
+
+        // 构建SLR(1)分析表
+        slr = build_slr_table(g, cc);
+        state_count = cc.C.size();
+        print_slr_table(slr, g, state_count);
+
+        if (!incremental_file.empty()) {
+            // 文法修改后的增量重建，并与完全重建比较
+            vector<string> new_rules;
+            if (!read_grammar_rules(incremental_file, new_rules)) {
+                cerr << "无法打开文法文件: " << incremental_file << endl;
+                return 1;
+            }
+            bool debug = DEBUG_MODE;
+            DEBUG_MODE = false;
+            auto t0 = chrono::steady_clock::now();
+            Grammar full_g;
+            full_g.parse(new_rules);
+            full_g.compute_first();
+            full_g.compute_follow();
+            CanonicalCollection full_cc = build_canonical_collection(full_g);
+            SLRTable full_table = build_slr_table(full_g, full_cc);
+            auto t1 = chrono::steady_clock::now();
+            Grammar new_g;
+            CanonicalCollection new_cc;
+            SLRTable new_table;
+            IncrementalStats st = rebuild_incremental(move(g), move(cc), move(slr), new_rules,
+                                                      new_g, new_cc, new_table);
+            auto t2 = chrono::steady_clock::now();
+            DEBUG_MODE = debug;
+
+            auto ms = [](chrono::steady_clock::duration d) {
+                return chrono::duration<double, milli>(d).count();
+            };
+            cout << "\n=== 增量重建: " << incremental_file << " ===" << endl;
+            cout << "增删的产生式: " << st.changed_productions << endl;
+            cout << "重算FIRST集的非终结符: " << st.first_recomputed << ", 重算FOLLOW集的非终结符: "
+                 << st.follow_recomputed << " (共 " << new_g.nonterminals.size() << ")" << endl;
+            cout << "状态: 保留 " << st.reused_states << ", 重新求闭包 " << st.recomputed_states
+                 << ", 新增 " << st.new_states << ", 删除 " << st.dropped_states
+                 << " (共 " << new_cc.C.size() << ")" << endl;
+            cout << "沿用的分析表行: " << st.reused_rows << ", 修补的分析表行: " << st.patched_rows << endl;
+            cout << "完全重建用时: " << fixed << setprecision(2) << ms(t1 - t0) << " ms, 增量重建用时: "
+                 << ms(t2 - t1) << " ms" << endl;
+            cout.unsetf(ios::floatfield);
+            cout << "与完全重建" << (equivalent_tables(new_cc, new_table, full_cc, full_table) ? "一致" : "不一致") << endl;
+
+            g = move(new_g);
+            cc = move(new_cc);
+            slr = move(new_table);
+            state_count = cc.C.size();
+            print_slr_table(slr, g, state_count);
+        }
+
+        if (use_lalr) {
+            // 在同一规范族上用DeRemer–Pennello关系计算LALR(1)向前看符号
+            SLRTable lalr = build_lalr_table(g, cc);
+            print_slr_table(lalr, g, state_count, "LALR(1)");
+            print_conflict_comparison(slr, lalr);
+            slr = lalr;
+        }
+    }
 
-    // 构建SLR(1)分析表
-    SLRTable slr = build_slr_table(g, cc);
-    print_slr_table(slr, g, cc.C.size());
+    // 生成压缩的运行时分析表
+    ParseTable pt = build_parse_table(g, slr, state_count);
+    pt.compress();
+    print_parse_table_stats(pt);
     return 0;
 } 
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+// SLR分析表生成器
+// 构建时运行一次：读入文法文件，用lr0.cpp中的算法构造SLR(1)分析表，
+// 压缩后输出只含constexpr数组的头文件，SLRParser直接在这些数组上查表。
+// 用法: slr_table_gen [--lalr] <文法文件> <输出头文件>
+#include "lr0.cpp"
+
+string cppString(const string& str) {
+    string result = "\"";
+    for (char c : str) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+template <typename Values>
+void writeArray(ostream& out, const string& type, const string& name, const Values& values, int perLine) {
+    out << "constexpr " << type << " " << name << "[] = {";
+    for (size_t i = 0; i < values.size(); ++i) {
+        out << (i % perLine == 0 ? "\n    " : " ") << values[i];
+        if (i + 1 < values.size()) out << ",";
+    }
+    out << "\n};\n\n";
+}
+
+void writeStrings(ostream& out, const string& name, const vector<string>& values) {
+    vector<string> quoted;
+    for (const auto& v : values) quoted.push_back(cppString(v));
+    writeArray(out, "const char*", name, quoted, 1);
+}
+
+int main(int argc, char* argv[]) {
+    // --lalr：用LALR(1)向前看符号代替FOLLOW集填归约动作
+    bool use_lalr = argc > 1 && string(argv[1]) == "--lalr";
+    if (use_lalr) {
+        --argc;
+        ++argv;
+    }
+    if (argc < 3) {
+        cerr << "用法: " << argv[0] << " [--lalr] <文法文件> <输出头文件>" << endl;
+        return 1;
+    }
+
+    vector<string> rules;
+    if (!read_grammar_rules(argv[1], rules)) {
+        cerr << "无法打开文法文件: " << argv[1] << endl;
+        return 1;
+    }
+
+    Grammar g;
+    g.parse(rules);
+    g.compute_first();
+    g.compute_follow();
+    CanonicalCollection cc = build_canonical_collection(g);
+    SLRTable slr = use_lalr ? build_lalr_table(g, cc) : build_slr_table(g, cc);
+    ParseTable pt = build_parse_table(g, slr, cc.C.size());
+    pt.compress();
+    for (const auto& c : slr.conflicts) cerr << "警告: " << c << endl;
+
+    vector<string> productions;
+    vector<int> lhs, rhsLength;
+    for (const auto& prod : g.productions) {
+        productions.push_back(production_signature(prod));
+        lhs.push_back(pt.nonterminals.at(prod.left));
+        rhsLength.push_back(prod.right.size());
+    }
+    vector<string> terminals, nonterminals;
+    for (int t = 0; t < pt.terminal_count(); ++t) terminals.push_back(pt.terminals[t]);
+    for (int nt = 0; nt < pt.nonterminal_count(); ++nt) nonterminals.push_back(pt.nonterminals[nt]);
+
+    ofstream out(argv[2]);
+    if (!out) {
+        cerr << "无法写入文件: " << argv[2] << endl;
+        return 1;
+    }
+    out << "// 由 slr_table_gen 根据 " << argv[1] << " 生成，请勿手工修改\n";
+    out << "// 动作编码见 lab3/lr0.cpp 中的 ParseTable\n\n";
+    out << "constexpr int SLR_STATE_COUNT = " << pt.state_count << ";\n";
+    out << "constexpr int SLR_TERMINAL_COUNT = " << pt.terminal_count() << ";\n";
+    out << "constexpr int SLR_NONTERMINAL_COUNT = " << pt.nonterminal_count() << ";\n";
+    out << "constexpr int SLR_PRODUCTION_COUNT = " << g.productions.size() << ";\n";
+    out << "constexpr int SLR_RULE_COUNT = " << rules.size() << ";\n\n";
+    writeStrings(out, "SLR_RULES", rules);
+    writeStrings(out, "SLR_TERMINALS", terminals);
+    writeStrings(out, "SLR_NONTERMINALS", nonterminals);
+    writeArray(out, "int32_t", "SLR_TERMINAL_ORDER", pt.terminals.sorted_ids(), 16);
+    writeArray(out, "int32_t", "SLR_NONTERMINAL_ORDER", pt.nonterminals.sorted_ids(), 16);
+    writeStrings(out, "SLR_PRODUCTIONS", productions);
+    writeArray(out, "int16_t", "SLR_PRODUCTION_LHS", lhs, 16);
+    writeArray(out, "int16_t", "SLR_PRODUCTION_RHS_LENGTH", rhsLength, 16);
+    // 压缩后的ACTION/GOTO表（行位移 + 默认动作），下标规则见 ParseTable::action_at / goto_at
+    writeArray(out, "int16_t", "SLR_DEFAULT_ACTION", pt.default_action, 16);
+    writeArray(out, "int32_t", "SLR_ACTION_BASE", pt.action_base, 16);
+    writeArray(out, "int16_t", "SLR_ACTION_VALUE", pt.action_value, 16);
+    writeArray(out, "int16_t", "SLR_ACTION_CHECK", pt.action_check, 16);
+    writeArray(out, "int16_t", "SLR_DEFAULT_GOTO", pt.default_goto, 16);
+    writeArray(out, "int32_t", "SLR_GOTO_BASE", pt.goto_base, 16);
+    writeArray(out, "int16_t", "SLR_GOTO_VALUE", pt.goto_value, 16);
+    writeArray(out, "int16_t", "SLR_GOTO_CHECK", pt.goto_check, 16);
+    writeArray(out, "int16_t", "SLR_SOLE_REDUCTION", pt.sole_reduction, 16);
+
+    cout << "已生成 " << argv[2] << ": " << pt.state_count << " 个状态, "
+         << g.productions.size() << " 条产生式" << endl;
+    return 0;
+}
@@ -74,6 +74,9 @@ private:
     int lineNumber;
     //int column;
     vector<Token> tokens;
+    DFA dfa;
+    ifstream file;
+    bool streaming;     // 逐行按需分析，已取走的记号不再保留
     
     map<string, TokenType> keywords = {
         {"int", TokenType::INT},
@@ -86,8 +89,9 @@ private:
     };
     
 public:
-    Lexer(const string filename) : filename(filename), pos(0), lineNumber(1) {
-        DFA dfa;
+    // streaming为false时在构造时分析整个文件；为true时不输出提示信息，
+    // 每次取记号时才读入并分析下一行，内存中只保留当前行的记号
+    Lexer(const string filename, bool streaming = false) : filename(filename), pos(0), lineNumber(1), streaming(streaming) {
         // 初始化关键字表
         dfa.initKeywords();
 
@@ -100,43 +104,16 @@ public:
         } 
         
         // 读取文件内容
-        ifstream file(filename);
+        file.open(filename);
         if (!file) {
             cout << "无法打开文件: " << filename << endl;
         }
-        
-        string line;
-        vector<pair<string, string>> allResults; // 存储所有行的分析结果
+        if (streaming) return;
         
         cout << "开始分析文件: " << filename << endl;
         
         // 逐行读取并分析文件
-        while (getline(file, line)) {
-            vector<string> tokensvalue = dfa.tokenizeInput(line);
-            vector<pair<string, string>> results; // 当前行的结果
-
-            for (const auto& tokenvalue : tokensvalue) {
-                string endState = dfa.getEndState(tokenvalue);
-                if (endState != "ERROR" && dfa.getAcceptStates().count(endState) > 0) {
-                    string type = dfa.getStateType(endState);
-                    type = dfa.classifyToken(type, tokenvalue);
-                    Token token;
-                    token.type = classifyToken(type);
-                    token.value = tokenvalue;
-                    token.line = lineNumber;
-                    token.column = 1;
-                    tokens.push_back(token);
-                } else {
-                    Token token;
-                    token.type = classifyToken("ERROR");
-                    token.value = tokenvalue;
-                    token.line = lineNumber;
-                    token.column = 1;
-                    tokens.push_back(token);
-                }
-            }
-            lineNumber++;
-        }
+        while (readLine()) {}
 
         file.close();
 
@@ -149,6 +126,19 @@ public:
         return Token(); 
     }
 
+    // 取下一个记号，输入结束时返回false
+    bool next(Token& token) {
+        while (pos >= tokens.size()) {
+            if (!streaming || !readLine()) return false;
+        }
+        token = tokens[pos++];
+        return true;
+    }
+
+    const string& getFilename() const {
+        return filename;
+    }
+
     int getPos() {
         return pos;
     }
@@ -163,8 +153,43 @@ public:
         }
         cout << endl;
     }
-    
+
+    // 分析一行文本，记号追加到out，行号记为number。各行的分析互不影响，
+    // 增量分析时只需对改动过的行调用
+    void tokenizeLine(const string& line, int number, vector<Token>& out) {
+        vector<string> tokensvalue = dfa.tokenizeInput(line);
+        for (const auto& tokenvalue : tokensvalue) {
+            string endState = dfa.getEndState(tokenvalue);
+            Token token;
+            if (endState != "ERROR" && dfa.getAcceptStates().count(endState) > 0) {
+                string type = dfa.getStateType(endState);
+                type = dfa.classifyToken(type, tokenvalue);
+                token.type = classifyToken(type);
+            } else {
+                token.type = classifyToken("ERROR");
+            }
+            token.value = tokenvalue;
+            token.line = number;
+            token.column = 1;
+            out.push_back(token);
+        }
+    }
+
 private:
+    // 分析下一行，把记号追加到缓冲区；流式模式下先丢弃已取走的记号
+    bool readLine() {
+        string line;
+        if (!getline(file, line)) return false;
+        if (streaming) {
+            tokens.erase(tokens.begin(), tokens.begin() + pos);
+            pos = 0;
+        }
+        
+        tokenizeLine(line, lineNumber, tokens);
+        lineNumber++;
+        return true;
+    }
+    
     TokenType classifyToken(const string& type) {
         //DIV MUL ASG LPA RPA LBK RBK LBR RBR  CMA SCO ROP  ID ADD IF ELSE WHILE RETURN INT FLOAT VOID
         //INT, FLOAT, VOID, IF, ELSE, WHILE, RETURN, ID, INT_NUM, FLOAT_NUM, ADD, MUL, ASG, REL_OP, SEMI, COMMA, LPAR, RPAR, LBR, RBR, LBRACK, RBRACK, EOF_TOKEN, UNKNOWN
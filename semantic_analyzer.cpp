@@ -9,7 +9,9 @@
 #include <algorithm>
 #include <fstream>  // 添加文件操作支持
 #include "lab3/lr0.cpp"
+#include "lab3/slr_table.h"
 #include "lexer.cpp"
+#include "error_handler.cpp"
 
 using namespace std;
 
@@ -48,7 +50,9 @@ enum class NodeType {
     IDENTIFIER,
     LITERAL,
     FUNCTION_CALL,
-    ARRAY_ACCESS
+    ARRAY_ACCESS,
+    PARAM_LIST,
+    ARG_LIST
 };
 
 // 数据类型枚举
@@ -60,25 +64,75 @@ enum class DataType {
     ARRAY_FLOAT,
     UNKNOWN
 };
-// JSON辅助函数
-string jsonIndent(int level) {
-    return string(level * 2, ' ');
-}
 
-string jsonEscape(const string& str) {
-    string result;
-    for (char c : str) {
-        switch (c) {
-            case '"': result += "\\\""; break;
-            case '\\': result += "\\\\"; break;
-            case '\n': result += "\\n"; break;
-            case '\r': result += "\\r"; break;
-            case '\t': result += "\\t"; break;
-            default: result += c; break;
-        }
-    }
-    return result;
-}
+// ===== 流式JSON输出 =====
+// 各节点把JSON文本直接追加到同一个大缓冲区，缓冲区满时整块写入输出流；
+// 不再由每个节点拼出自己的字符串、再逐层复制到父节点的字符串中
+struct JSONIndent {
+    int level;      // 缩进层数，每层两个空格
+};
+
+struct JSONString {
+    const string& text;     // 按JSON字符串转义后输出
+};
+
+class JSONWriter {
+public:
+    explicit JSONWriter(ostream& out) : out(out) {}
+    
+    ~JSONWriter() {
+        flush();
+    }
+    
+    JSONWriter& operator<<(const char* text) {
+        buffer += text;
+        return spill();
+    }
+    
+    JSONWriter& operator<<(const string& text) {
+        buffer += text;
+        return spill();
+    }
+    
+    JSONWriter& operator<<(int value) {
+        buffer += to_string(value);
+        return spill();
+    }
+    
+    JSONWriter& operator<<(JSONIndent indent) {
+        buffer.append(indent.level * 2, ' ');
+        return spill();
+    }
+    
+    JSONWriter& operator<<(JSONString str) {
+        for (char c : str.text) {
+            switch (c) {
+                case '"': buffer += "\\\""; break;
+                case '\\': buffer += "\\\\"; break;
+                case '\n': buffer += "\\n"; break;
+                case '\r': buffer += "\\r"; break;
+                case '\t': buffer += "\\t"; break;
+                default: buffer += c; break;
+            }
+        }
+        return spill();
+    }
+    
+    void flush() {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+    
+private:
+    enum { BUFFER_SIZE = 1 << 20 };
+    ostream& out;
+    string buffer;
+    
+    JSONWriter& spill() {
+        if (buffer.size() >= BUFFER_SIZE) flush();
+        return *this;
+    }
+};
 
 string nodeTypeToString(NodeType type) {
     switch (type) {
@@ -97,6 +151,8 @@ string nodeTypeToString(NodeType type) {
         case NodeType::LITERAL: return "Literal";
         case NodeType::FUNCTION_CALL: return "FunctionCall";
         case NodeType::ARRAY_ACCESS: return "ArrayAccess";
+        case NodeType::PARAM_LIST: return "ParamList";
+        case NodeType::ARG_LIST: return "ArgList";
         default: return "Unknown";
     }
 }
@@ -126,7 +182,16 @@ public:
     virtual void print(int indent = 0) const = 0;
     virtual void printTree(const string& prefix = "", bool isLast = true) const = 0;
     virtual string toString() const = 0;
-    virtual string toJSON(int indent = 0) const = 0;  // 新增JSON输出功能
+    virtual void writeJSON(JSONWriter& json, int indent = 0) const = 0;  // 新增JSON输出功能
+    
+    string toJSON(int indent = 0) const {
+        ostringstream out;
+        {
+            JSONWriter json(out);
+            writeJSON(json, indent);
+        }
+        return out.str();
+    }
 };
 
 // 表达式节点基类
@@ -165,13 +230,11 @@ public:
         return name;
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"name\": \"" << jsonEscape(name) << "\"\n";
-        json << jsonIndent(indent) << "}";
-        return json.str();
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"name\": \"" << JSONString{name} << "\"\n";
+        json << JSONIndent{indent} << "}";
     }
 };
 
@@ -212,14 +275,12 @@ public:
         return value;
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"value\": \"" << jsonEscape(value) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"dataType\": \"" << dataTypeToString(dataType) << "\"\n";
-        json << jsonIndent(indent) << "}";
-        return json.str();
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"value\": \"" << JSONString{value} << "\",\n";
+        json << JSONIndent{indent + 1} << "\"dataType\": \"" << dataTypeToString(dataType) << "\"\n";
+        json << JSONIndent{indent} << "}";
     }
 };
 
@@ -263,21 +324,21 @@ public:
         return "(" + (left ? left->toString() : "") + " " + op + " " + (right ? right->toString() : "") + ")";
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"operator\": \"" << jsonEscape(op) << "\",\n";
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"operator\": \"" << JSONString{op} << "\",\n";
         if (left) {
-            json << jsonIndent(indent + 1) << "\"left\": \n";
-            json << left->toJSON(indent + 1) << ",\n";
+            json << JSONIndent{indent + 1} << "\"left\": \n";
+            left->writeJSON(json, indent + 1);
+            json << ",\n";
         }
         if (right) {
-            json << jsonIndent(indent + 1) << "\"right\": \n";
-            json << right->toJSON(indent + 1) << "\n";
+            json << JSONIndent{indent + 1} << "\"right\": \n";
+            right->writeJSON(json, indent + 1);
+            json << "\n";
         }
-        json << jsonIndent(indent) << "}";
-        return json.str();
+        json << JSONIndent{indent} << "}";
     }
 };
 
@@ -336,20 +397,18 @@ public:
         return result;
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"varType\": \"" << dataTypeToString(varType) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"name\": \"" << jsonEscape(name) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"isArray\": " << (isArray ? "true" : "false") << ",\n";
-        json << jsonIndent(indent + 1) << "\"arraySize\": " << arraySize;
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"varType\": \"" << dataTypeToString(varType) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"name\": \"" << JSONString{name} << "\",\n";
+        json << JSONIndent{indent + 1} << "\"isArray\": " << (isArray ? "true" : "false") << ",\n";
+        json << JSONIndent{indent + 1} << "\"arraySize\": " << arraySize;
         if (initializer) {
-            json << ",\n" << jsonIndent(indent + 1) << "\"initializer\": \n";
-            json << initializer->toJSON(indent + 1);
+            json << ",\n" << JSONIndent{indent + 1} << "\"initializer\": \n";
+            initializer->writeJSON(json, indent + 1);
         }
-        json << "\n" << jsonIndent(indent) << "}";
-        return json.str();
+        json << "\n" << JSONIndent{indent} << "}";
     }
 };
 
@@ -392,20 +451,18 @@ public:
         return (target ? target->toString() : "") + " = " + (value ? value->toString() : "");
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\"";
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\"";
         if (target) {
-            json << ",\n" << jsonIndent(indent + 1) << "\"target\": \n";
-            json << target->toJSON(indent + 1);
+            json << ",\n" << JSONIndent{indent + 1} << "\"target\": \n";
+            target->writeJSON(json, indent + 1);
         }
         if (value) {
-            json << ",\n" << jsonIndent(indent + 1) << "\"value\": \n";
-            json << value->toJSON(indent + 1);
+            json << ",\n" << JSONIndent{indent + 1} << "\"value\": \n";
+            value->writeJSON(json, indent + 1);
         }
-        json << "\n" << jsonIndent(indent) << "}";
-        return json.str();
+        json << "\n" << JSONIndent{indent} << "}";
     }
 };
 
@@ -449,23 +506,21 @@ public:
         return result;
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"statements\": [\n";
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"statements\": [\n";
         for (size_t i = 0; i < statements.size(); ++i) {
             if (statements[i]) {
-                json << statements[i]->toJSON(indent + 2);
+                statements[i]->writeJSON(json, indent + 2);
                 if (i < statements.size() - 1) {
                     json << ",";
                 }
                 json << "\n";
             }
         }
-        json << jsonIndent(indent + 1) << "]\n";
-        json << jsonIndent(indent) << "}";
-        return json.str();
+        json << JSONIndent{indent + 1} << "]\n";
+        json << JSONIndent{indent} << "}";
     }
 };
 
@@ -533,24 +588,22 @@ public:
         return result;
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\"";
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\"";
         if (condition) {
-            json << ",\n" << jsonIndent(indent + 1) << "\"condition\": \n";
-            json << condition->toJSON(indent + 1);
+            json << ",\n" << JSONIndent{indent + 1} << "\"condition\": \n";
+            condition->writeJSON(json, indent + 1);
         }
         if (thenStmt) {
-            json << ",\n" << jsonIndent(indent + 1) << "\"thenStmt\": \n";
-            json << thenStmt->toJSON(indent + 1);
+            json << ",\n" << JSONIndent{indent + 1} << "\"thenStmt\": \n";
+            thenStmt->writeJSON(json, indent + 1);
         }
         if (elseStmt) {
-            json << ",\n" << jsonIndent(indent + 1) << "\"elseStmt\": \n";
-            json << elseStmt->toJSON(indent + 1);
+            json << ",\n" << JSONIndent{indent + 1} << "\"elseStmt\": \n";
+            elseStmt->writeJSON(json, indent + 1);
         }
-        json << "\n" << jsonIndent(indent) << "}";
-        return json.str();
+        json << "\n" << JSONIndent{indent} << "}";
     }
 };
 
@@ -602,20 +655,18 @@ public:
         return "while (" + (condition ? condition->toString() : "") + ") " + (body ? body->toString() : "");
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\"";
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\"";
         if (condition) {
-            json << ",\n" << jsonIndent(indent + 1) << "\"condition\": \n";
-            json << condition->toJSON(indent + 1);
+            json << ",\n" << JSONIndent{indent + 1} << "\"condition\": \n";
+            condition->writeJSON(json, indent + 1);
         }
         if (body) {
-            json << ",\n" << jsonIndent(indent + 1) << "\"body\": \n";
-            json << body->toJSON(indent + 1);
+            json << ",\n" << JSONIndent{indent + 1} << "\"body\": \n";
+            body->writeJSON(json, indent + 1);
         }
-        json << "\n" << jsonIndent(indent) << "}";
-        return json.str();
+        json << "\n" << JSONIndent{indent} << "}";
     }
 };
 
@@ -653,16 +704,17 @@ public:
         }
     }
     
-    string toJSON(int indent = 0) const override {
-        string result = "{\n";
-        result += jsonIndent(indent + 1) + "\"type\": \"ReturnStmt\",\n";
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"ReturnStmt\",\n";
         if (returnValue) {
-            result += jsonIndent(indent + 1) + "\"returnValue\": " + returnValue->toJSON(indent + 1) + "\n";
+            json << JSONIndent{indent + 1} << "\"returnValue\": ";
+            returnValue->writeJSON(json, indent + 1);
+            json << "\n";
         } else {
-            result += jsonIndent(indent + 1) + "\"returnValue\": null\n";
+            json << JSONIndent{indent + 1} << "\"returnValue\": null\n";
         }
-        result += jsonIndent(indent) + "}";
-        return result;
+        json << JSONIndent{indent} << "}";
     }
 };
 
@@ -711,27 +763,83 @@ public:
         return result;
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"functionName\": \"" << jsonEscape(functionName) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"arguments\": [\n";
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"functionName\": \"" << JSONString{functionName} << "\",\n";
+        json << JSONIndent{indent + 1} << "\"arguments\": [\n";
         for (size_t i = 0; i < arguments.size(); ++i) {
             if (arguments[i]) {
-                json << arguments[i]->toJSON(indent + 2);
+                arguments[i]->writeJSON(json, indent + 2);
                 if (i < arguments.size() - 1) {
                     json << ",";
                 }
                 json << "\n";
             }
         }
-        json << jsonIndent(indent + 1) << "]\n";
-        json << jsonIndent(indent) << "}";
-        return json.str();
+        json << JSONIndent{indent + 1} << "]\n";
+        json << JSONIndent{indent} << "}";
+    }
+};
+
+// 形参/实参列表节点：只在语法分析过程中存在，归约时原地追加，
+// 最后由函数定义或函数调用节点整体取走元素
+template <typename T>
+class ListNode : public ASTNode {
+public:
+    vector<shared_ptr<T>> items;
+    
+    ListNode(NodeType t) : ASTNode(t) {}
+    
+    void append(shared_ptr<T> item) {
+        items.push_back(move(item));
+    }
+    
+    void print(int indent = 0) const override {
+        cout << string(indent, ' ') << nodeTypeToString(type) << " (" << items.size() << ")" << endl;
+        for (const auto& item : items) {
+            if (item) item->print(indent + 2);
+        }
+    }
+    
+    void printTree(const string& prefix = "", bool isLast = true) const override {
+        printTreeHelper(prefix, nodeTypeToString(type), isLast);
+        string childPrefix = getChildPrefix(prefix, isLast);
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (items[i]) items[i]->printTree(childPrefix, i == items.size() - 1);
+        }
+    }
+    
+    string toString() const override {
+        string result;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i > 0) result += ", ";
+            if (items[i]) result += items[i]->toString();
+        }
+        return result;
+    }
+    
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"items\": [\n";
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (items[i]) {
+                items[i]->writeJSON(json, indent + 2);
+                if (i < items.size() - 1) {
+                    json << ",";
+                }
+                json << "\n";
+            }
+        }
+        json << JSONIndent{indent + 1} << "]\n";
+        json << JSONIndent{indent} << "}";
     }
 };
 
+typedef ListNode<VariableDeclNode> ParamListNode;
+typedef ListNode<ExpressionNode> ArgListNode;
+
 // 函数定义节点
 class FunctionDefNode : public ASTNode {
 public:
@@ -812,29 +920,27 @@ public:
         return result;
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"returnType\": \"" << dataTypeToString(returnType) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"name\": \"" << jsonEscape(name) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"parameters\": [\n";
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"returnType\": \"" << dataTypeToString(returnType) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"name\": \"" << JSONString{name} << "\",\n";
+        json << JSONIndent{indent + 1} << "\"parameters\": [\n";
         for (size_t i = 0; i < parameters.size(); ++i) {
             if (parameters[i]) {
-                json << parameters[i]->toJSON(indent + 2);
+                parameters[i]->writeJSON(json, indent + 2);
                 if (i < parameters.size() - 1) {
                     json << ",";
                 }
                 json << "\n";
             }
         }
-        json << jsonIndent(indent + 1) << "]";
+        json << JSONIndent{indent + 1} << "]";
         if (body) {
-            json << ",\n" << jsonIndent(indent + 1) << "\"body\": \n";
-            json << body->toJSON(indent + 1);
+            json << ",\n" << JSONIndent{indent + 1} << "\"body\": \n";
+            body->writeJSON(json, indent + 1);
         }
-        json << "\n" << jsonIndent(indent) << "}";
-        return json.str();
+        json << "\n" << JSONIndent{indent} << "}";
     }
 };
 
@@ -910,34 +1016,32 @@ public:
         return result;
     }
     
-    string toJSON(int indent = 0) const override {
-        ostringstream json;
-        json << jsonIndent(indent) << "{\n";
-        json << jsonIndent(indent + 1) << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
-        json << jsonIndent(indent + 1) << "\"globalVariables\": [\n";
+    void writeJSON(JSONWriter& json, int indent = 0) const override {
+        json << JSONIndent{indent} << "{\n";
+        json << JSONIndent{indent + 1} << "\"type\": \"" << nodeTypeToString(type) << "\",\n";
+        json << JSONIndent{indent + 1} << "\"globalVariables\": [\n";
         for (size_t i = 0; i < globalVariables.size(); ++i) {
             if (globalVariables[i]) {
-                json << globalVariables[i]->toJSON(indent + 2);
+                globalVariables[i]->writeJSON(json, indent + 2);
                 if (i < globalVariables.size() - 1) {
                     json << ",";
                 }
                 json << "\n";
             }
         }
-        json << jsonIndent(indent + 1) << "],\n";
-        json << jsonIndent(indent + 1) << "\"functions\": [\n";
+        json << JSONIndent{indent + 1} << "],\n";
+        json << JSONIndent{indent + 1} << "\"functions\": [\n";
         for (size_t i = 0; i < functions.size(); ++i) {
             if (functions[i]) {
-                json << functions[i]->toJSON(indent + 2);
+                functions[i]->writeJSON(json, indent + 2);
                 if (i < functions.size() - 1) {
                     json << ",";
                 }
                 json << "\n";
             }
         }
-        json << jsonIndent(indent + 1) << "]\n";
-        json << jsonIndent(indent) << "}";
-        return json.str();
+        json << JSONIndent{indent + 1} << "]\n";
+        json << JSONIndent{indent} << "}";
     }
 };
 
@@ -947,7 +1051,11 @@ public:
 void saveASTtoJSON(shared_ptr<ASTNode> ast, const string& filename) {
     ofstream file(filename);
     if (file.is_open()) {
-        file << ast->toJSON() << endl;
+        {
+            JSONWriter json(file);
+            ast->writeJSON(json);
+            json << "\n";
+        }
         file.close();
         cout << "AST已保存到文件: " << filename << endl;
     } else {
@@ -955,163 +1063,1102 @@ void saveASTtoJSON(shared_ptr<ASTNode> ast, const string& filename) {
     }
 }
 
-// 符号表条目
-struct SymbolEntry {
-    string name;
-    DataType type;
-    int scope;
-    bool isFunction;
-    vector<DataType> paramTypes;  // 函数参数类型
-    bool isArray;
-    int arraySize;
-    int address;  // 变量地址（用于中间代码生成）
-    
-    SymbolEntry(const string& n, DataType t, int s, bool isFunc = false) 
-        : name(n), type(t), scope(s), isFunction(isFunc), isArray(false), arraySize(0), address(-1) {}
-};
+// ===== 表达式结构哈希 =====
+// 结构哈希由种类、运算符、标识符名或字面量以及各子表达式的哈希组合而成，
+// 结构相同的表达式子树哈希相同。组合方式沿用分析表缓存的64位FNV-1a
+uint64_t hashCombine(uint64_t h, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        h ^= (value >> (i * 8)) & 0xFF;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
 
-// 符号表类
-class SymbolTable {
-private:
-    vector<SymbolEntry> symbols;
-    vector<int> scopeStack;  // 作用域栈
-    int currentScope;
-    int nextAddress;
-    vector<SymbolEntry> allSymbols;  // 保存所有曾经声明的符号（用于调试输出）
-    
-public:
-    SymbolTable() : currentScope(0), nextAddress(0) {
-        scopeStack.push_back(0);
+uint64_t hashText(uint64_t h, const string& text) {
+    h = hashCombine(h, text.size());
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 1099511628211ULL;
     }
-    
-    // 进入新作用域
-    void enterScope() {
-        currentScope++;
-        scopeStack.push_back(currentScope);
-        DEBUG_PRINT(cout << "进入作用域 " << currentScope << endl);
+    return h;
+}
+
+// 节点自身（不含子节点）的哈希
+uint64_t shallowHash(const ExpressionNode* expr) {
+    uint64_t h = hashCombine(1469598103934665603ULL, (uint64_t)expr->type);
+    h = hashCombine(h, (uint64_t)expr->dataType);
+    switch (expr->type) {
+        case NodeType::IDENTIFIER:
+            return hashText(h, static_cast<const IdentifierNode*>(expr)->name);
+        case NodeType::LITERAL:
+            return hashText(h, static_cast<const LiteralNode*>(expr)->value);
+        case NodeType::BINARY_OP:
+        case NodeType::ARRAY_ACCESS:
+            return hashText(h, static_cast<const BinaryOpNode*>(expr)->op);
+        case NodeType::FUNCTION_CALL:
+            return hashText(h, static_cast<const FunctionCallNode*>(expr)->functionName);
+        default:
+            return h;
     }
-    
-    // 退出当前作用域
-    void exitScope() {
-        if (scopeStack.size() > 1) {
-            int exitingScope = scopeStack.back();
-            scopeStack.pop_back();
-            currentScope = scopeStack.back();
-            
-            // 移除退出作用域中的符号
-            symbols.erase(
-                remove_if(symbols.begin(), symbols.end(),
-                    [exitingScope](const SymbolEntry& entry) {
-                        return entry.scope == exitingScope;
-                    }),
-                symbols.end()
-            );
-            
-            DEBUG_PRINT(cout << "退出作用域 " << exitingScope << "，回到作用域 " << currentScope << endl);
+}
+
+uint64_t structuralHash(const ExpressionNode* expr) {
+    if (!expr) return 0;
+    uint64_t h = shallowHash(expr);
+    switch (expr->type) {
+        case NodeType::BINARY_OP:
+        case NodeType::ARRAY_ACCESS: {
+            auto binOp = static_cast<const BinaryOpNode*>(expr);
+            h = hashCombine(h, structuralHash(binOp->left.get()));
+            return hashCombine(h, structuralHash(binOp->right.get()));
+        }
+        case NodeType::FUNCTION_CALL: {
+            auto call = static_cast<const FunctionCallNode*>(expr);
+            for (const auto& arg : call->arguments) h = hashCombine(h, structuralHash(arg.get()));
+            return h;
+        }
+        case NodeType::ASSIGNMENT: {
+            // 赋值以表达式语句的形式出现，也参与哈希
+            auto assign = static_cast<const AssignmentNode*>(static_cast<const ASTNode*>(expr));
+            h = hashCombine(h, structuralHash(assign->target.get()));
+            return hashCombine(h, structuralHash(assign->value.get()));
         }
+        default:
+            return h;
     }
-    
-    // 声明变量
-    bool declareVariable(const string& name, DataType type, bool isArray = false, int arraySize = 0) {
-        // 检查当前作用域是否已存在同名变量
-        for (const auto& entry : symbols) {
-            if (entry.name == name && entry.scope == currentScope) {
-                return false;  // 重复声明
+}
+
+// 没有副作用的表达式：标识符、字面量以及由它们组成的运算和数组访问。
+// 只有这些表达式可以合并为同一个节点，函数调用和赋值每次出现都要求值
+bool isPureExpression(const ExpressionNode* expr) {
+    if (!expr) return false;
+    switch (expr->type) {
+        case NodeType::IDENTIFIER:
+        case NodeType::LITERAL:
+            return true;
+        case NodeType::BINARY_OP:
+        case NodeType::ARRAY_ACCESS: {
+            auto binOp = static_cast<const BinaryOpNode*>(expr);
+            return isPureExpression(binOp->left.get()) && isPureExpression(binOp->right.get());
+        }
+        default:
+            return false;
+    }
+}
+
+// 哈希合并表：自底向上遍历AST，结构相同的纯表达式子树只保留第一次遇到的节点，
+// 其余出现处改为指向它。子节点先合并，因此判断两个节点相同时只需比较自身字段和子节点指针。
+// 合并后AST变成有向无环图，后续各遍可以按节点缓存结果（类型、临时变量）
+class ExpressionTable {
+public:
+    // 合并整个AST中的表达式
+    void internTree(const shared_ptr<ASTNode>& node) {
+        if (!node) return;
+        switch (node->type) {
+            case NodeType::PROGRAM: {
+                auto program = static_pointer_cast<ProgramNode>(node);
+                for (auto& var : program->globalVariables) internTree(var);
+                for (auto& func : program->functions) internTree(func);
+                break;
+            }
+            case NodeType::FUNCTION_DEF:
+                internTree(static_pointer_cast<FunctionDefNode>(node)->body);
+                break;
+            case NodeType::COMPOUND_STMT:
+                for (auto& stmt : static_pointer_cast<CompoundStmtNode>(node)->statements) internTree(stmt);
+                break;
+            case NodeType::VARIABLE_DECL: {
+                auto decl = static_pointer_cast<VariableDeclNode>(node);
+                decl->initializer = intern(decl->initializer);
+                break;
+            }
+            case NodeType::ASSIGNMENT: {
+                auto assign = static_pointer_cast<AssignmentNode>(node);
+                assign->target = intern(assign->target);
+                assign->value = intern(assign->value);
+                break;
+            }
+            case NodeType::IF_STMT: {
+                auto ifStmt = static_pointer_cast<IfStmtNode>(node);
+                ifStmt->condition = intern(ifStmt->condition);
+                internTree(ifStmt->thenStmt);
+                internTree(ifStmt->elseStmt);
+                break;
             }
+            case NodeType::WHILE_STMT: {
+                auto whileStmt = static_pointer_cast<WhileStmtNode>(node);
+                whileStmt->condition = intern(whileStmt->condition);
+                internTree(whileStmt->body);
+                break;
+            }
+            case NodeType::RETURN_STMT: {
+                auto returnStmt = static_pointer_cast<ReturnStmtNode>(node);
+                returnStmt->returnValue = intern(returnStmt->returnValue);
+                break;
+            }
+            default:
+                // 表达式语句：语句位置上的节点本身保留，只合并其中的子表达式
+                internChildren(static_pointer_cast<ExpressionNode>(node));
+                break;
         }
-        
-        SymbolEntry entry(name, type, currentScope);
-        entry.isArray = isArray;
-        entry.arraySize = arraySize;
-        entry.address = nextAddress++;
-        symbols.push_back(entry);
-        allSymbols.push_back(entry);  // 同时保存到allSymbols中
-        
-        DEBUG_PRINT(cout << "声明变量: " << name << " (类型: "; printDataType(type); cout << ", 作用域: " << currentScope << ", 地址: " << entry.address << ")" << endl);
-        
-        return true;
     }
     
-    // 声明函数
-    bool declareFunction(const string& name, DataType returnType, const vector<DataType>& paramTypes) {
-        // 检查是否已存在同名函数
-        for (const auto& entry : symbols) {
-            if (entry.name == name && entry.isFunction) {
-                return false;  // 重复声明
-            }
+    // 返回与expr结构相同的规范节点；expr不是纯表达式时合并其子表达式后原样返回
+    shared_ptr<ExpressionNode> intern(const shared_ptr<ExpressionNode>& expr) {
+        if (!expr) return expr;
+        visited++;
+        internChildren(expr);
+        if (!isPureExpression(expr.get())) return expr;
+        uint64_t h = shallowHash(expr.get());
+        if (expr->type == NodeType::BINARY_OP || expr->type == NodeType::ARRAY_ACCESS) {
+            auto binOp = static_cast<const BinaryOpNode*>(expr.get());
+            h = hashCombine(hashCombine(h, hashes.at(binOp->left.get())), hashes.at(binOp->right.get()));
         }
-        
-        SymbolEntry entry(name, returnType, 0, true);  // 函数总是在全局作用域
-        entry.paramTypes = paramTypes;
-        symbols.push_back(entry);
-        allSymbols.push_back(entry);  // 同时保存到allSymbols中
-        
-        DEBUG_PRINT(cout << "声明函数: " << name << " (返回类型: "; printDataType(returnType); cout << ", 参数个数: " << paramTypes.size() << ")" << endl);
-        
-        return true;
+        auto& bucket = table[h];
+        for (const auto& candidate : bucket) {
+            if (sameNode(candidate.get(), expr.get())) return candidate;
+        }
+        bucket.push_back(expr);
+        hashes[expr.get()] = h;
+        return expr;
     }
     
-    // 查找符号
-    SymbolEntry* lookup(const string& name) {
-        // 从当前作用域向外查找
-        for (int i = scopeStack.size() - 1; i >= 0; i--) {
-            int scope = scopeStack[i];
-            for (auto& entry : symbols) {
-                if (entry.name == name && entry.scope == scope) {
-                    return &entry;
-                }
+    // 遍历过的表达式节点数和合并后剩下的不同纯表达式数
+    size_t visitedCount() const { return visited; }
+    size_t uniqueCount() const { return hashes.size(); }
+    
+private:
+    unordered_map<uint64_t, vector<shared_ptr<ExpressionNode>>> table;
+    unordered_map<const ExpressionNode*, uint64_t> hashes;   // 规范节点 -> 结构哈希
+    size_t visited = 0;
+    
+    void internChildren(const shared_ptr<ExpressionNode>& expr) {
+        switch (expr->type) {
+            case NodeType::BINARY_OP:
+            case NodeType::ARRAY_ACCESS: {
+                auto binOp = static_pointer_cast<BinaryOpNode>(expr);
+                binOp->left = intern(binOp->left);
+                binOp->right = intern(binOp->right);
+                break;
+            }
+            case NodeType::FUNCTION_CALL:
+                for (auto& arg : static_pointer_cast<FunctionCallNode>(expr)->arguments) arg = intern(arg);
+                break;
+            case NodeType::ASSIGNMENT: {
+                auto assign = static_pointer_cast<AssignmentNode>(static_pointer_cast<ASTNode>(expr));
+                assign->target = intern(assign->target);
+                assign->value = intern(assign->value);
+                break;
             }
+            default:
+                break;
         }
-        
-        // 查找全局函数
-        for (auto& entry : symbols) {
-            if (entry.name == name && entry.isFunction) {
-                return &entry;
+    }
+    
+    // 子节点都已是规范节点，比较自身字段和子节点指针即可
+    static bool sameNode(const ExpressionNode* a, const ExpressionNode* b) {
+        if (a->type != b->type || a->dataType != b->dataType) return false;
+        switch (a->type) {
+            case NodeType::IDENTIFIER:
+                return static_cast<const IdentifierNode*>(a)->name == static_cast<const IdentifierNode*>(b)->name;
+            case NodeType::LITERAL:
+                return static_cast<const LiteralNode*>(a)->value == static_cast<const LiteralNode*>(b)->value;
+            case NodeType::BINARY_OP:
+            case NodeType::ARRAY_ACCESS: {
+                auto x = static_cast<const BinaryOpNode*>(a);
+                auto y = static_cast<const BinaryOpNode*>(b);
+                return x->op == y->op && x->left == y->left && x->right == y->right;
             }
+            default:
+                return false;
         }
-        
-        return nullptr;  // 未找到
     }
+};
+
+// ===== 扁平AST =====
+// AST的另一种存储方式：节点按先序排在连续数组中，节点之间用32位下标引用。
+// 各节点的种类、数据类型和行列号放在并行数组里，各种类特有的字段按种类放在各自的数组中，
+// 由data指向。先序遍历时访问的节点下标依次增大，对大程序的各遍分析是顺序扫过几块连续内存，
+// 而不是沿着指针在堆上跳来跳去
+class FlatAST {
+public:
+    typedef uint32_t Index;
+    enum : Index { NONE = 0xFFFFFFFFu };   // 没有该子节点
     
-    // 检查变量是否已声明
-    bool isDeclared(const string& name) {
-        return lookup(name) != nullptr;
+    // 子节点序列在lists中的区间
+    struct Range {
+        Index first, count;
+    };
+    
+    // 各种类特有的字段，子节点均为节点下标，名字和运算符为strings下标
+    struct BinaryOp { Index op, left, right; };
+    struct VariableDecl { Index name; DataType varType; bool isArray; int arraySize; Index initializer; };
+    struct Assignment { Index target, value; };
+    struct IfStmt { Index condition, thenStmt, elseStmt; };
+    struct WhileStmt { Index condition, body; };
+    struct FunctionCall { Index name; Range arguments; };
+    struct FunctionDef { Index name; DataType returnType; Range parameters; Index body; };
+    struct Program { Range globalVariables, functions; };
+    
+    // 按节点下标的并行数组，0号为根
+    vector<NodeType> kind;
+    vector<DataType> dataType;
+    vector<int> line;
+    vector<int> column;
+    // 该节点在其种类数组中的下标；标识符和字面量为strings下标，
+    // return语句为返回值节点（可为NONE），复合语句为compoundStmts下标
+    vector<Index> data;
+    
+    // 按种类的数组
+    vector<BinaryOp> binaryOps;             // BINARY_OP和ARRAY_ACCESS
+    vector<VariableDecl> variableDecls;
+    vector<Assignment> assignments;
+    vector<IfStmt> ifStmts;
+    vector<WhileStmt> whileStmts;
+    vector<FunctionCall> functionCalls;
+    vector<FunctionDef> functionDefs;
+    vector<Program> programs;
+    vector<Range> compoundStmts;
+    
+    vector<Index> lists;                    // 各Range引用的子节点下标
+    vector<string> strings;                 // 名字、运算符和字面量，相同的只存一份
+    
+    FlatAST() {}
+    
+    // 由指针树构造；空指针子节点（如空语句）不出现在扁平AST中
+    explicit FlatAST(const shared_ptr<ASTNode>& root) {
+        if (root) add(root.get());
+        stringIds.clear();
     }
     
-    // 获取变量类型
-    DataType getType(const string& name) {
-        SymbolEntry* entry = lookup(name);
-        return entry ? entry->type : DataType::UNKNOWN;
+    Index size() const { return kind.size(); }
+    bool empty() const { return kind.empty(); }
+    
+    const string& str(Index i) const { return strings[i]; }
+    Index child(const Range& range, Index k) const { return lists[range.first + k]; }
+    
+    const BinaryOp& binaryOp(Index node) const { return binaryOps[data[node]]; }
+    const VariableDecl& variableDecl(Index node) const { return variableDecls[data[node]]; }
+    const Assignment& assignment(Index node) const { return assignments[data[node]]; }
+    const IfStmt& ifStmt(Index node) const { return ifStmts[data[node]]; }
+    const WhileStmt& whileStmt(Index node) const { return whileStmts[data[node]]; }
+    const FunctionCall& functionCall(Index node) const { return functionCalls[data[node]]; }
+    const FunctionDef& functionDef(Index node) const { return functionDefs[data[node]]; }
+    const Program& program(Index node) const { return programs[data[node]]; }
+    const Range& compoundStmt(Index node) const { return compoundStmts[data[node]]; }
+    
+private:
+    unordered_map<string, Index> stringIds;  // 仅构造时用于合并相同的字符串
+    
+    Index intern(const string& s) {
+        auto it = stringIds.find(s);
+        if (it != stringIds.end()) return it->second;
+        strings.push_back(s);
+        stringIds.emplace(s, strings.size() - 1);
+        return strings.size() - 1;
     }
     
-    // 打印符号表
-    void printSymbolTable() const {
-        cout << "\n=== 符号表 ===" << endl;
-        cout << "当前作用域: " << currentScope << endl;
-        cout << "作用域栈: ";
-        for (int scope : scopeStack) {
-            cout << scope << " ";
-        }
-        cout << endl;
-        
-        // 按作用域分组显示所有符号
-        map<int, vector<SymbolEntry>> scopeGroups;
-        for (const auto& entry : allSymbols) {
-            scopeGroups[entry.scope].push_back(entry);
-        }
+    Index add(const ASTNode* node) {
+        if (!node) return NONE;
+        Index id = kind.size();
+        kind.push_back(node->type);
+        dataType.push_back(node->dataType);
+        line.push_back(node->line);
+        column.push_back(node->column);
+        data.push_back(NONE);
         
-        // 显示每个作用域的符号
-        for (const auto& pair : scopeGroups) {
-            int scope = pair.first;
-            const vector<SymbolEntry>& entries = pair.second;
-            
-            cout << "\n作用域 " << scope;
-            if (scope == 0) {
-                cout << " (全局):";
-            } else if (scope == 1) {
-                cout << " (函数):";  
-            } else {
-                cout << " (局部):";
+        // 先占好种类数组中的位置再添加子节点，保证节点按先序编号；
+        // 子节点添加时各数组可能扩容，因此只能通过下标回填
+        switch (node->type) {
+            case NodeType::IDENTIFIER:
+                data[id] = intern(static_cast<const IdentifierNode*>(node)->name);
+                break;
+            case NodeType::LITERAL:
+                data[id] = intern(static_cast<const LiteralNode*>(node)->value);
+                break;
+            case NodeType::BINARY_OP:
+            case NodeType::ARRAY_ACCESS: {
+                auto n = static_cast<const BinaryOpNode*>(node);
+                Index k = data[id] = binaryOps.size();
+                binaryOps.push_back({intern(n->op), NONE, NONE});
+                Index left = add(n->left.get());
+                binaryOps[k].left = left;
+                Index right = add(n->right.get());
+                binaryOps[k].right = right;
+                break;
+            }
+            case NodeType::VARIABLE_DECL: {
+                auto n = static_cast<const VariableDeclNode*>(node);
+                Index k = data[id] = variableDecls.size();
+                variableDecls.push_back({intern(n->name), n->varType, n->isArray, n->arraySize, NONE});
+                Index init = add(n->initializer.get());
+                variableDecls[k].initializer = init;
+                break;
+            }
+            case NodeType::ASSIGNMENT: {
+                auto n = static_cast<const AssignmentNode*>(node);
+                Index k = data[id] = assignments.size();
+                assignments.push_back({NONE, NONE});
+                Index target = add(n->target.get());
+                assignments[k].target = target;
+                Index value = add(n->value.get());
+                assignments[k].value = value;
+                break;
+            }
+            case NodeType::IF_STMT: {
+                auto n = static_cast<const IfStmtNode*>(node);
+                Index k = data[id] = ifStmts.size();
+                ifStmts.push_back({NONE, NONE, NONE});
+                Index condition = add(n->condition.get());
+                ifStmts[k].condition = condition;
+                Index thenStmt = add(n->thenStmt.get());
+                ifStmts[k].thenStmt = thenStmt;
+                Index elseStmt = add(n->elseStmt.get());
+                ifStmts[k].elseStmt = elseStmt;
+                break;
+            }
+            case NodeType::WHILE_STMT: {
+                auto n = static_cast<const WhileStmtNode*>(node);
+                Index k = data[id] = whileStmts.size();
+                whileStmts.push_back({NONE, NONE});
+                Index condition = add(n->condition.get());
+                whileStmts[k].condition = condition;
+                Index body = add(n->body.get());
+                whileStmts[k].body = body;
+                break;
+            }
+            case NodeType::RETURN_STMT: {
+                Index value = add(static_cast<const ReturnStmtNode*>(node)->returnValue.get());
+                data[id] = value;
+                break;
+            }
+            case NodeType::COMPOUND_STMT: {
+                Index k = data[id] = compoundStmts.size();
+                compoundStmts.push_back({0, 0});
+                Range range = addList(static_cast<const CompoundStmtNode*>(node)->statements);
+                compoundStmts[k] = range;
+                break;
+            }
+            case NodeType::FUNCTION_CALL: {
+                auto n = static_cast<const FunctionCallNode*>(node);
+                Index k = data[id] = functionCalls.size();
+                functionCalls.push_back({intern(n->functionName), {0, 0}});
+                Range arguments = addList(n->arguments);
+                functionCalls[k].arguments = arguments;
+                break;
+            }
+            case NodeType::FUNCTION_DEF: {
+                auto n = static_cast<const FunctionDefNode*>(node);
+                Index k = data[id] = functionDefs.size();
+                functionDefs.push_back({intern(n->name), n->returnType, {0, 0}, NONE});
+                Range parameters = addList(n->parameters);
+                functionDefs[k].parameters = parameters;
+                Index body = add(n->body.get());
+                functionDefs[k].body = body;
+                break;
+            }
+            case NodeType::PROGRAM: {
+                auto n = static_cast<const ProgramNode*>(node);
+                Index k = data[id] = programs.size();
+                programs.push_back({{0, 0}, {0, 0}});
+                Range globals = addList(n->globalVariables);
+                programs[k].globalVariables = globals;
+                Range functions = addList(n->functions);
+                programs[k].functions = functions;
+                break;
+            }
+            default:
+                break;
+        }
+        return id;
+    }
+    
+    // 子节点序列在lists中占连续的一段，先占位，逐个添加后回填
+    template <typename T>
+    Range addList(const vector<shared_ptr<T>>& items) {
+        Index count = 0;
+        for (const auto& item : items) {
+            if (item) count++;
+        }
+        Range range = {(Index)lists.size(), count};
+        lists.resize(lists.size() + count);
+        Index k = range.first;
+        for (const auto& item : items) {
+            if (!item) continue;
+            Index c = add(item.get());
+            lists[k++] = c;
+        }
+        return range;
+    }
+};
+
+// ===== 二进制AST =====
+// 紧凑的AST文件格式，供缓存和其他工具读取，比ast.json小得多，也不必做文本解析。
+// 整数一律用LEB128变长编码，因此与字节序无关。文件布局：
+//   魔数"ASTB" | 版本 | 字符串数 | 各字符串（长度, 字节）| 节点数 | 先序排列的节点记录
+// 节点记录：种类 | 数据类型 | 行 | 列 | 按种类的字段，其后紧跟各子节点的记录。
+// 可以没有的子节点由flags中的位标明是否存在；整数字面量直接存值（zigzag编码），
+// 其他字面量存字符串表下标。文件可以mmap后用BinaryASTReader逐个读出记录，不必重建节点
+const uint32_t BINARY_AST_MAGIC = 0x42545341;  // "ASTB"
+const uint32_t BINARY_AST_VERSION = 1;
+
+// 一个节点记录中的字段，各种类用到的字段：
+//   IDENTIFIER      name
+//   LITERAL         flags&1时为整数value，否则name为文本
+//   BINARY_OP       name为运算符，flags: 1左 2右
+//   VARIABLE_DECL   name, declType, arraySize, flags: 1初始值 2数组
+//   ASSIGNMENT      flags: 1目标 2值
+//   IF_STMT         flags: 1条件 2then 4else
+//   WHILE_STMT      flags: 1条件 2循环体
+//   RETURN_STMT     flags: 1返回值
+//   COMPOUND_STMT   count个语句
+//   FUNCTION_CALL   name, count个实参
+//   FUNCTION_DEF    name, declType为返回类型, count个形参, flags: 1函数体
+//   PROGRAM         count个全局变量, count2个函数
+struct BinaryASTRecord {
+    NodeType kind = NodeType::PROGRAM;
+    DataType dataType = DataType::UNKNOWN;
+    int line = 0;
+    int column = 0;
+    uint32_t name = 0;
+    uint32_t flags = 0;
+    int64_t value = 0;
+    DataType declType = DataType::UNKNOWN;
+    int arraySize = 0;
+    uint32_t count = 0;
+    uint32_t count2 = 0;
+};
+
+class BinaryASTWriter {
+public:
+    string buf;
+    
+    void varint(uint64_t v) {
+        while (v >= 0x80) {
+            buf += (char)(v | 0x80);
+            v >>= 7;
+        }
+        buf += (char)v;
+    }
+    
+    void zigzag(int64_t v) {
+        varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+    
+    void write(const FlatAST& ast) {
+        varint(BINARY_AST_MAGIC);
+        varint(BINARY_AST_VERSION);
+        varint(ast.strings.size());
+        for (const auto& s : ast.strings) {
+            varint(s.size());
+            buf += s;
+        }
+        varint(ast.size());
+        // 扁平AST的节点本来就按先序编号，顺序写出即可
+        for (FlatAST::Index i = 0; i < ast.size(); i++) {
+            writeRecord(ast, i);
+        }
+    }
+    
+private:
+    static uint32_t present(FlatAST::Index node, uint32_t bit) {
+        return node != FlatAST::NONE ? bit : 0;
+    }
+    
+    // 十进制写法规范（无前导零、不超出范围）的整数字面量可以按值存储，读回时文本不变
+    static bool integerLiteral(const string& text, int64_t& value) {
+        if (text.empty() || text.size() > 18) return false;
+        if (text.size() > 1 && text[0] == '0') return false;
+        value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') return false;
+            value = value * 10 + (c - '0');
+        }
+        return true;
+    }
+    
+    void writeRecord(const FlatAST& ast, FlatAST::Index node) {
+        NodeType kind = ast.kind[node];
+        varint((uint64_t)kind);
+        varint((uint64_t)ast.dataType[node]);
+        zigzag(ast.line[node]);
+        zigzag(ast.column[node]);
+        switch (kind) {
+            case NodeType::IDENTIFIER:
+                varint(ast.data[node]);
+                break;
+            case NodeType::LITERAL: {
+                int64_t value;
+                if (integerLiteral(ast.str(ast.data[node]), value)) {
+                    varint(1);
+                    zigzag(value);
+                } else {
+                    varint(0);
+                    varint(ast.data[node]);
+                }
+                break;
+            }
+            case NodeType::BINARY_OP:
+            case NodeType::ARRAY_ACCESS: {
+                const FlatAST::BinaryOp& n = ast.binaryOp(node);
+                varint(n.op);
+                varint(present(n.left, 1) | present(n.right, 2));
+                break;
+            }
+            case NodeType::VARIABLE_DECL: {
+                const FlatAST::VariableDecl& n = ast.variableDecl(node);
+                varint(n.name);
+                varint((uint64_t)n.varType);
+                varint(present(n.initializer, 1) | (n.isArray ? 2 : 0));
+                zigzag(n.arraySize);
+                break;
+            }
+            case NodeType::ASSIGNMENT: {
+                const FlatAST::Assignment& n = ast.assignment(node);
+                varint(present(n.target, 1) | present(n.value, 2));
+                break;
+            }
+            case NodeType::IF_STMT: {
+                const FlatAST::IfStmt& n = ast.ifStmt(node);
+                varint(present(n.condition, 1) | present(n.thenStmt, 2) | present(n.elseStmt, 4));
+                break;
+            }
+            case NodeType::WHILE_STMT: {
+                const FlatAST::WhileStmt& n = ast.whileStmt(node);
+                varint(present(n.condition, 1) | present(n.body, 2));
+                break;
+            }
+            case NodeType::RETURN_STMT:
+                varint(present(ast.data[node], 1));
+                break;
+            case NodeType::COMPOUND_STMT:
+                varint(ast.compoundStmt(node).count);
+                break;
+            case NodeType::FUNCTION_CALL: {
+                const FlatAST::FunctionCall& n = ast.functionCall(node);
+                varint(n.name);
+                varint(n.arguments.count);
+                break;
+            }
+            case NodeType::FUNCTION_DEF: {
+                const FlatAST::FunctionDef& n = ast.functionDef(node);
+                varint(n.name);
+                varint((uint64_t)n.returnType);
+                varint(n.parameters.count);
+                varint(present(n.body, 1));
+                break;
+            }
+            case NodeType::PROGRAM: {
+                const FlatAST::Program& n = ast.program(node);
+                varint(n.globalVariables.count);
+                varint(n.functions.count);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+};
+
+// 在内存中（通常是mmap得到的文件映像）按先序逐个读出节点记录。
+// 字符串表只记录各字符串的位置，不复制；任何越界或非法值都使ok为false
+class BinaryASTReader {
+public:
+    bool ok = true;
+    
+    BinaryASTReader(const char* data, size_t size) : p((const uint8_t*)data), end((const uint8_t*)data + size) {
+        ok = varint() == BINARY_AST_MAGIC && varint() == BINARY_AST_VERSION;
+        uint64_t stringCount = varint();
+        for (uint64_t i = 0; ok && i < stringCount; i++) {
+            uint64_t length = varint();
+            if (!ok || (uint64_t)(end - p) < length) {
+                ok = false;
+                break;
+            }
+            strings.emplace_back((const char*)p, length);
+            p += length;
+        }
+        nodeCount = varint();
+    }
+    
+    // 文件中的节点总数
+    uint64_t size() const { return nodeCount; }
+    
+    // 字符串表中的第id个字符串
+    string str(uint32_t id) const {
+        if (id >= strings.size()) return "";
+        return string(strings[id].first, strings[id].second);
+    }
+    
+    // 读出下一个节点记录，没有更多记录或文件损坏时返回false
+    bool next(BinaryASTRecord& record) {
+        if (!ok || readCount >= nodeCount) return false;
+        readCount++;
+        record = BinaryASTRecord();
+        uint64_t kind = varint();
+        uint64_t dataType = varint();
+        if (kind > (uint64_t)NodeType::ARG_LIST || dataType > (uint64_t)DataType::UNKNOWN) ok = false;
+        record.kind = (NodeType)kind;
+        record.dataType = (DataType)dataType;
+        record.line = (int)zigzag();
+        record.column = (int)zigzag();
+        switch (record.kind) {
+            case NodeType::IDENTIFIER:
+                record.name = stringId();
+                break;
+            case NodeType::LITERAL:
+                record.flags = varint();
+                if (record.flags & 1) record.value = zigzag();
+                else record.name = stringId();
+                break;
+            case NodeType::BINARY_OP:
+            case NodeType::ARRAY_ACCESS:
+                record.name = stringId();
+                record.flags = varint();
+                break;
+            case NodeType::VARIABLE_DECL:
+                record.name = stringId();
+                record.declType = dataTypeValue();
+                record.flags = varint();
+                record.arraySize = (int)zigzag();
+                break;
+            case NodeType::ASSIGNMENT:
+            case NodeType::IF_STMT:
+            case NodeType::WHILE_STMT:
+            case NodeType::RETURN_STMT:
+                record.flags = varint();
+                break;
+            case NodeType::COMPOUND_STMT:
+                record.count = countValue();
+                break;
+            case NodeType::FUNCTION_CALL:
+                record.name = stringId();
+                record.count = countValue();
+                break;
+            case NodeType::FUNCTION_DEF:
+                record.name = stringId();
+                record.declType = dataTypeValue();
+                record.count = countValue();
+                record.flags = varint();
+                break;
+            case NodeType::PROGRAM:
+                record.count = countValue();
+                record.count2 = countValue();
+                break;
+            default:
+                break;
+        }
+        return ok;
+    }
+    
+    // 从当前位置读出一棵子树并重建为指针树，读到的是整个文件时即为完整的AST。
+    // 嵌套超过MAX_DEPTH层的文件视为损坏，不会因递归过深而栈溢出
+    shared_ptr<ASTNode> readTree() {
+        if (depth >= MAX_DEPTH) {
+            ok = false;
+            return nullptr;
+        }
+        ++depth;
+        shared_ptr<ASTNode> node = readNode();
+        --depth;
+        return node;
+    }
+    
+private:
+    enum { MAX_DEPTH = 2048 };
+    const uint8_t* p;
+    const uint8_t* end;
+    vector<pair<const char*, size_t>> strings;
+    uint64_t nodeCount = 0;
+    uint64_t readCount = 0;
+    int depth = 0;
+    
+    shared_ptr<ASTNode> readNode() {
+        BinaryASTRecord r;
+        if (!next(r)) return nullptr;
+        shared_ptr<ASTNode> node;
+        switch (r.kind) {
+            case NodeType::IDENTIFIER:
+                node = make_shared<IdentifierNode>(str(r.name));
+                break;
+            case NodeType::LITERAL:
+                node = make_shared<LiteralNode>((r.flags & 1) ? to_string(r.value) : str(r.name), r.dataType);
+                break;
+            case NodeType::BINARY_OP:
+            case NodeType::ARRAY_ACCESS: {
+                auto left = (r.flags & 1) ? readExpression() : nullptr;
+                auto right = (r.flags & 2) ? readExpression() : nullptr;
+                node = make_shared<BinaryOpNode>(str(r.name), left, right);
+                node->type = r.kind;
+                break;
+            }
+            case NodeType::VARIABLE_DECL: {
+                auto decl = make_shared<VariableDeclNode>(r.declType, str(r.name), (r.flags & 1) ? readExpression() : nullptr);
+                decl->isArray = (r.flags & 2) != 0;
+                decl->arraySize = r.arraySize;
+                node = decl;
+                break;
+            }
+            case NodeType::ASSIGNMENT: {
+                auto target = (r.flags & 1) ? readExpression() : nullptr;
+                auto value = (r.flags & 2) ? readExpression() : nullptr;
+                node = make_shared<AssignmentNode>(target, value);
+                break;
+            }
+            case NodeType::IF_STMT: {
+                auto condition = (r.flags & 1) ? readExpression() : nullptr;
+                auto thenStmt = (r.flags & 2) ? readStatement() : nullptr;
+                auto elseStmt = (r.flags & 4) ? readStatement() : nullptr;
+                node = make_shared<IfStmtNode>(condition, thenStmt, elseStmt);
+                break;
+            }
+            case NodeType::WHILE_STMT: {
+                auto condition = (r.flags & 1) ? readExpression() : nullptr;
+                auto body = (r.flags & 2) ? readStatement() : nullptr;
+                node = make_shared<WhileStmtNode>(condition, body);
+                break;
+            }
+            case NodeType::RETURN_STMT:
+                node = make_shared<ReturnStmtNode>((r.flags & 1) ? readExpression() : nullptr);
+                break;
+            case NodeType::COMPOUND_STMT: {
+                auto compound = make_shared<CompoundStmtNode>();
+                for (uint32_t i = 0; ok && i < r.count; i++) compound->addStatement(readStatement());
+                node = compound;
+                break;
+            }
+            case NodeType::FUNCTION_CALL: {
+                auto call = make_shared<FunctionCallNode>(str(r.name));
+                for (uint32_t i = 0; ok && i < r.count; i++) call->addArgument(readExpression());
+                node = call;
+                break;
+            }
+            case NodeType::FUNCTION_DEF: {
+                auto func = make_shared<FunctionDefNode>(r.declType, str(r.name));
+                for (uint32_t i = 0; ok && i < r.count; i++) {
+                    func->addParameter(static_pointer_cast<VariableDeclNode>(readKind(NodeType::VARIABLE_DECL)));
+                }
+                if (r.flags & 1) func->body = static_pointer_cast<CompoundStmtNode>(readKind(NodeType::COMPOUND_STMT));
+                node = func;
+                break;
+            }
+            case NodeType::PROGRAM: {
+                auto program = make_shared<ProgramNode>();
+                for (uint32_t i = 0; ok && i < r.count; i++) {
+                    program->addGlobalVariable(static_pointer_cast<VariableDeclNode>(readKind(NodeType::VARIABLE_DECL)));
+                }
+                for (uint32_t i = 0; ok && i < r.count2; i++) {
+                    program->addFunction(static_pointer_cast<FunctionDefNode>(readKind(NodeType::FUNCTION_DEF)));
+                }
+                node = program;
+                break;
+            }
+            default:
+                ok = false;
+                return nullptr;
+        }
+        node->dataType = r.dataType;
+        node->line = r.line;
+        node->column = r.column;
+        return ok ? node : nullptr;
+    }
+    
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) break;
+            uint8_t byte = *p++;
+            v |= (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+    
+    int64_t zigzag() {
+        uint64_t v = varint();
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+    
+    uint32_t stringId() {
+        uint64_t id = varint();
+        if (id >= strings.size()) ok = false;
+        return (uint32_t)id;
+    }
+    
+    DataType dataTypeValue() {
+        uint64_t v = varint();
+        if (v > (uint64_t)DataType::UNKNOWN) ok = false;
+        return (DataType)v;
+    }
+    
+    // 子节点个数不会超过剩余的节点数
+    uint32_t countValue() {
+        uint64_t v = varint();
+        if (v > nodeCount - readCount) ok = false;
+        return (uint32_t)v;
+    }
+    
+    // 读出一棵子树，并检查根节点是否为预期的种类
+    shared_ptr<ASTNode> readKind(NodeType kind) {
+        auto node = readTree();
+        if (node && node->type != kind) {
+            ok = false;
+            return nullptr;
+        }
+        return node;
+    }
+    
+    // 表达式位置可能出现的节点：赋值也是表达式（Expr -> ID ASG Expr），与语法分析得到的AST一致
+    static bool isExpressionKind(NodeType kind) {
+        switch (kind) {
+            case NodeType::IDENTIFIER:
+            case NodeType::LITERAL:
+            case NodeType::BINARY_OP:
+            case NodeType::ARRAY_ACCESS:
+            case NodeType::FUNCTION_CALL:
+            case NodeType::ASSIGNMENT:
+                return true;
+            default:
+                return false;
+        }
+    }
+    
+    // 语句位置可能出现的节点：表达式语句直接以表达式节点出现
+    static bool isStatementKind(NodeType kind) {
+        switch (kind) {
+            case NodeType::VARIABLE_DECL:
+            case NodeType::IF_STMT:
+            case NodeType::WHILE_STMT:
+            case NodeType::RETURN_STMT:
+            case NodeType::COMPOUND_STMT:
+                return true;
+            default:
+                return isExpressionKind(kind);
+        }
+    }
+    
+    shared_ptr<ExpressionNode> readExpression() {
+        auto node = readTree();
+        if (node && !isExpressionKind(node->type)) {
+            ok = false;
+            return nullptr;
+        }
+        return static_pointer_cast<ExpressionNode>(node);
+    }
+    
+    shared_ptr<StatementNode> readStatement() {
+        auto node = readTree();
+        if (node && !isStatementKind(node->type)) {
+            ok = false;
+            return nullptr;
+        }
+        return static_pointer_cast<StatementNode>(node);
+    }
+};
+
+// 把AST写成二进制文件，先写临时文件再改名
+bool saveBinaryAST(const shared_ptr<ASTNode>& ast, const string& filename) {
+    BinaryASTWriter w;
+    w.write(FlatAST(ast));
+    string tmp = filename + ".tmp" + to_string(getpid());
+    ofstream out(tmp, ios::binary);
+    if (!out) return false;
+    out.write(w.buf.data(), w.buf.size());
+    out.close();
+    if (!out || rename(tmp.c_str(), filename.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// mmap二进制AST文件并重建为指针树，文件不存在或损坏时返回空指针
+shared_ptr<ASTNode> loadBinaryAST(const string& filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    
+    BinaryASTReader reader((const char*)data, st.st_size);
+    shared_ptr<ASTNode> ast = reader.ok ? reader.readTree() : nullptr;
+    munmap(data, st.st_size);
+    return reader.ok ? ast : nullptr;
+}
+
+// 符号表条目
+struct SymbolEntry {
+    string name;
+    DataType type;
+    int scope;
+    bool isFunction;
+    vector<DataType> paramTypes;  // 函数参数类型
+    bool isArray;
+    int arraySize;
+    int address;  // 变量地址（用于中间代码生成）
+    
+    SymbolEntry(const string& n, DataType t, int s, bool isFunc = false) 
+        : name(n), type(t), scope(s), isFunction(isFunc), isArray(false), arraySize(0), address(-1) {}
+};
+
+// 符号表类
+class SymbolTable {
+private:
+    vector<SymbolEntry> symbols;
+    vector<int> scopeStack;  // 作用域栈
+    int currentScope;
+    int nextAddress;
+    vector<SymbolEntry> allSymbols;  // 保存所有曾经声明的符号（用于调试输出）
+    unsigned long generation;        // 每次作用域或符号变化时加一
+    
+public:
+    SymbolTable() : currentScope(0), nextAddress(0), generation(0) {
+        scopeStack.push_back(0);
+    }
+    
+    // 符号表的版本号，相同时任何名字的查找结果都不变
+    unsigned long getGeneration() const {
+        return generation;
+    }
+    
+    // 进入新作用域
+    void enterScope() {
+        generation++;
+        currentScope++;
+        scopeStack.push_back(currentScope);
+        DEBUG_PRINT(cout << "进入作用域 " << currentScope << endl);
+    }
+    
+    // 退出当前作用域
+    void exitScope() {
+        if (scopeStack.size() > 1) {
+            generation++;
+            int exitingScope = scopeStack.back();
+            scopeStack.pop_back();
+            currentScope = scopeStack.back();
+            
+            // 移除退出作用域中的符号
+            symbols.erase(
+                remove_if(symbols.begin(), symbols.end(),
+                    [exitingScope](const SymbolEntry& entry) {
+                        return entry.scope == exitingScope;
+                    }),
+                symbols.end()
+            );
+            
+            DEBUG_PRINT(cout << "退出作用域 " << exitingScope << "，回到作用域 " << currentScope << endl);
+        }
+    }
+    
+    // 声明变量
+    bool declareVariable(const string& name, DataType type, bool isArray = false, int arraySize = 0) {
+        // 检查当前作用域是否已存在同名变量
+        for (const auto& entry : symbols) {
+            if (entry.name == name && entry.scope == currentScope) {
+                return false;  // 重复声明
+            }
+        }
+        
+        generation++;
+        SymbolEntry entry(name, type, currentScope);
+        entry.isArray = isArray;
+        entry.arraySize = arraySize;
+        entry.address = nextAddress++;
+        symbols.push_back(entry);
+        allSymbols.push_back(entry);  // 同时保存到allSymbols中
+        
+        DEBUG_PRINT(cout << "声明变量: " << name << " (类型: "; printDataType(type); cout << ", 作用域: " << currentScope << ", 地址: " << entry.address << ")" << endl);
+        
+        return true;
+    }
+    
+    // 声明函数
+    bool declareFunction(const string& name, DataType returnType, const vector<DataType>& paramTypes) {
+        // 检查是否已存在同名函数
+        for (const auto& entry : symbols) {
+            if (entry.name == name && entry.isFunction) {
+                return false;  // 重复声明
+            }
+        }
+        
+        generation++;
+        SymbolEntry entry(name, returnType, 0, true);  // 函数总是在全局作用域
+        entry.paramTypes = paramTypes;
+        symbols.push_back(entry);
+        allSymbols.push_back(entry);  // 同时保存到allSymbols中
+        
+        DEBUG_PRINT(cout << "声明函数: " << name << " (返回类型: "; printDataType(returnType); cout << ", 参数个数: " << paramTypes.size() << ")" << endl);
+        
+        return true;
+    }
+    
+    // 查找符号
+    SymbolEntry* lookup(const string& name) {
+        // 从当前作用域向外查找
+        for (int i = scopeStack.size() - 1; i >= 0; i--) {
+            int scope = scopeStack[i];
+            for (auto& entry : symbols) {
+                if (entry.name == name && entry.scope == scope) {
+                    return &entry;
+                }
+            }
+        }
+        
+        // 查找全局函数
+        for (auto& entry : symbols) {
+            if (entry.name == name && entry.isFunction) {
+                return &entry;
+            }
+        }
+        
+        return nullptr;  // 未找到
+    }
+    
+    // 检查变量是否已声明
+    bool isDeclared(const string& name) {
+        return lookup(name) != nullptr;
+    }
+    
+    // 获取变量类型
+    DataType getType(const string& name) {
+        SymbolEntry* entry = lookup(name);
+        return entry ? entry->type : DataType::UNKNOWN;
+    }
+    
+    // 打印符号表
+    void printSymbolTable() const {
+        cout << "\n=== 符号表 ===" << endl;
+        cout << "当前作用域: " << currentScope << endl;
+        cout << "作用域栈: ";
+        for (int scope : scopeStack) {
+            cout << scope << " ";
+        }
+        cout << endl;
+        
+        // 按作用域分组显示所有符号
+        map<int, vector<SymbolEntry>> scopeGroups;
+        for (const auto& entry : allSymbols) {
+            scopeGroups[entry.scope].push_back(entry);
+        }
+        
+        // 显示每个作用域的符号
+        for (const auto& pair : scopeGroups) {
+            int scope = pair.first;
+            const vector<SymbolEntry>& entries = pair.second;
+            
+            cout << "\n作用域 " << scope;
+            if (scope == 0) {
+                cout << " (全局):";
+            } else if (scope == 1) {
+                cout << " (函数):";  
+            } else {
+                cout << " (局部):";
             }
             cout << endl;
             
@@ -1171,7 +2218,21 @@ private:
     SymbolTable symbolTable;
     vector<SemanticError> errors;
     
+    // 表达式类型缓存：哈希合并后同一个表达式节点会在多处出现，符号表版本相同时
+    // 其类型不变。只缓存分析时没有报错的结果，每处出现的错误仍照常报告
+    struct CachedType {
+        unsigned long generation;
+        DataType type;
+    };
+    bool cacheTypes = false;
+    unordered_map<const ExpressionNode*, CachedType> typeCache;
+    
 public:
+    // AST经过哈希合并（见 ExpressionTable）后启用类型缓存
+    void enableTypeCache() {
+        cacheTypes = true;
+    }
+    
     // 分析程序节点
     bool analyzeProgram(shared_ptr<ProgramNode> program) {
         if (!program) return false;
@@ -1328,88 +2389,283 @@ public:
             analyzeStatement(ifStmt->thenStmt);
         }
         
-        if (ifStmt->elseStmt) {
-            analyzeStatement(ifStmt->elseStmt);
+        if (ifStmt->elseStmt) {
+            analyzeStatement(ifStmt->elseStmt);
+        }
+    }
+    
+    // 分析while语句
+    void analyzeWhileStmt(shared_ptr<WhileStmtNode> whileStmt) {
+        if (!whileStmt) return;
+        
+        if (whileStmt->condition) {
+            analyzeExpression(whileStmt->condition);
+        }
+        
+        if (whileStmt->body) {
+            analyzeStatement(whileStmt->body);
+        }
+    }
+    
+    // 分析return语句
+    void analyzeReturnStmt(shared_ptr<ReturnStmtNode> returnStmt) {
+        if (!returnStmt) return;
+        
+        // 分析返回值表达式
+        if (returnStmt->returnValue) {
+            analyzeExpression(returnStmt->returnValue);
+        }
+        
+        // TODO: 可以在这里添加返回类型检查，确保返回值类型与函数返回类型匹配
+    }
+    
+    // 分析表达式
+    DataType analyzeExpression(shared_ptr<ExpressionNode> expr) {
+        if (!expr) return DataType::UNKNOWN;
+        if (!cacheTypes || (expr->type != NodeType::IDENTIFIER && expr->type != NodeType::BINARY_OP)) {
+            return checkExpression(expr);
+        }
+        
+        auto it = typeCache.find(expr.get());
+        if (it != typeCache.end() && it->second.generation == symbolTable.getGeneration()) {
+            return it->second.type;
+        }
+        size_t errorCount = errors.size();
+        DataType type = checkExpression(expr);
+        if (errors.size() == errorCount) {
+            typeCache[expr.get()] = {symbolTable.getGeneration(), type};
+        }
+        return type;
+    }
+    
+    DataType checkExpression(const shared_ptr<ExpressionNode>& expr) {
+        switch (expr->type) {
+            case NodeType::IDENTIFIER: {
+                auto id = static_pointer_cast<IdentifierNode>(expr);
+                if (!symbolTable.isDeclared(id->name)) {
+                    errors.push_back(SemanticError("变量 '" + id->name + "' 未声明", id->line, id->column));
+                    return DataType::UNKNOWN;
+                }
+                return symbolTable.getType(id->name);
+            }
+            case NodeType::LITERAL: {
+                auto lit = static_pointer_cast<LiteralNode>(expr);
+                return lit->dataType;
+            }
+            case NodeType::BINARY_OP: {
+                auto binOp = static_pointer_cast<BinaryOpNode>(expr);
+                DataType leftType = analyzeExpression(binOp->left);
+                DataType rightType = analyzeExpression(binOp->right);
+                
+                if (leftType != DataType::UNKNOWN && rightType != DataType::UNKNOWN && leftType != rightType) {
+                    errors.push_back(SemanticError("二元操作类型不匹配", binOp->line, binOp->column));
+                }
+                
+                // 关系操作返回int类型（布尔值）
+                if (binOp->op == "<" || binOp->op == "<=" || binOp->op == "==" || 
+                    binOp->op == ">" || binOp->op == ">=" || binOp->op == "!=") {
+                    return DataType::INT;
+                }
+                
+                return leftType;
+            }
+            case NodeType::FUNCTION_CALL: {
+                auto call = static_pointer_cast<FunctionCallNode>(expr);
+                SymbolEntry* func = symbolTable.lookup(call->functionName);
+                if (!func || !func->isFunction) {
+                    errors.push_back(SemanticError("函数 '" + call->functionName + "' 未声明", call->line, call->column));
+                    return DataType::UNKNOWN;
+                }
+                
+                // 检查参数个数
+                if (call->arguments.size() != func->paramTypes.size()) {
+                    errors.push_back(SemanticError("函数 '" + call->functionName + "' 参数个数不匹配", call->line, call->column));
+                }
+                
+                // 检查参数类型
+                for (size_t i = 0; i < min(call->arguments.size(), func->paramTypes.size()); i++) {
+                    DataType argType = analyzeExpression(call->arguments[i]);
+                    if (argType != DataType::UNKNOWN && argType != func->paramTypes[i]) {
+                        errors.push_back(SemanticError("函数 '" + call->functionName + "' 第" + to_string(i+1) + "个参数类型不匹配", call->line, call->column));
+                    }
+                }
+                
+                return func->type;
+            }
+            default:
+                return DataType::UNKNOWN;
+        }
+    }
+    
+    // ===== 扁平AST上的分析 =====
+    // 与上面基于指针树的分析逐条对应，按先序遍历扁平AST，报告的错误及其顺序相同
+    
+    bool analyzeProgram(const FlatAST& ast) {
+        if (ast.empty() || ast.kind[0] != NodeType::PROGRAM) return false;
+        
+        DEBUG_PRINT(cout << "\n=== 开始语义分析 ===" << endl);
+        
+        const FlatAST::Program& program = ast.program(0);
+        for (FlatAST::Index k = 0; k < program.globalVariables.count; k++) {
+            analyzeVariableDecl(ast, ast.child(program.globalVariables, k));
+        }
+        for (FlatAST::Index k = 0; k < program.functions.count; k++) {
+            analyzeFunction(ast, ast.child(program.functions, k));
+        }
+        
+        if (DEBUG_MODE) {
+            symbolTable.printSymbolTable();
+        }
+        
+        printErrors();
+        
+        return errors.empty();
+    }
+    
+    void analyzeFunction(const FlatAST& ast, FlatAST::Index node) {
+        const FlatAST::FunctionDef& func = ast.functionDef(node);
+        const string& name = ast.str(func.name);
+        
+        DEBUG_PRINT(cout << "\n分析函数: " << name << endl);
+        
+        vector<DataType> paramTypes;
+        for (FlatAST::Index k = 0; k < func.parameters.count; k++) {
+            paramTypes.push_back(ast.variableDecl(ast.child(func.parameters, k)).varType);
+        }
+        
+        if (!symbolTable.declareFunction(name, func.returnType, paramTypes)) {
+            errors.push_back(SemanticError("函数 '" + name + "' 重复声明", ast.line[node], ast.column[node]));
+        }
+        
+        symbolTable.enterScope();
+        
+        for (FlatAST::Index k = 0; k < func.parameters.count; k++) {
+            FlatAST::Index p = ast.child(func.parameters, k);
+            const FlatAST::VariableDecl& param = ast.variableDecl(p);
+            if (!symbolTable.declareVariable(ast.str(param.name), param.varType, param.isArray, param.arraySize)) {
+                errors.push_back(SemanticError("参数 '" + ast.str(param.name) + "' 重复声明", ast.line[p], ast.column[p]));
+            }
+        }
+        
+        if (func.body != FlatAST::NONE) {
+            analyzeCompoundStmt(ast, func.body);
         }
+        
+        symbolTable.exitScope();
     }
     
-    // 分析while语句
-    void analyzeWhileStmt(shared_ptr<WhileStmtNode> whileStmt) {
-        if (!whileStmt) return;
+    void analyzeCompoundStmt(const FlatAST& ast, FlatAST::Index node) {
+        const FlatAST::Range& statements = ast.compoundStmt(node);
         
-        if (whileStmt->condition) {
-            analyzeExpression(whileStmt->condition);
+        symbolTable.enterScope();
+        for (FlatAST::Index k = 0; k < statements.count; k++) {
+            analyzeStatement(ast, ast.child(statements, k));
         }
+        symbolTable.exitScope();
+    }
+    
+    void analyzeStatement(const FlatAST& ast, FlatAST::Index node) {
+        if (node == FlatAST::NONE) return;
         
-        if (whileStmt->body) {
-            analyzeStatement(whileStmt->body);
+        switch (ast.kind[node]) {
+            case NodeType::VARIABLE_DECL:
+                analyzeVariableDecl(ast, node);
+                break;
+            case NodeType::ASSIGNMENT: {
+                const FlatAST::Assignment& assign = ast.assignment(node);
+                DataType targetType = analyzeExpression(ast, assign.target);
+                DataType valueType = analyzeExpression(ast, assign.value);
+                if (targetType != DataType::UNKNOWN && valueType != DataType::UNKNOWN && targetType != valueType) {
+                    errors.push_back(SemanticError("赋值类型不匹配", ast.line[node], ast.column[node]));
+                }
+                break;
+            }
+            case NodeType::IF_STMT: {
+                const FlatAST::IfStmt& ifStmt = ast.ifStmt(node);
+                analyzeExpression(ast, ifStmt.condition);
+                analyzeStatement(ast, ifStmt.thenStmt);
+                analyzeStatement(ast, ifStmt.elseStmt);
+                break;
+            }
+            case NodeType::WHILE_STMT: {
+                const FlatAST::WhileStmt& whileStmt = ast.whileStmt(node);
+                analyzeExpression(ast, whileStmt.condition);
+                analyzeStatement(ast, whileStmt.body);
+                break;
+            }
+            case NodeType::RETURN_STMT:
+                analyzeExpression(ast, ast.data[node]);
+                break;
+            case NodeType::COMPOUND_STMT:
+                analyzeCompoundStmt(ast, node);
+                break;
+            default:
+                break;
         }
     }
     
-    // 分析return语句
-    void analyzeReturnStmt(shared_ptr<ReturnStmtNode> returnStmt) {
-        if (!returnStmt) return;
+    void analyzeVariableDecl(const FlatAST& ast, FlatAST::Index node) {
+        const FlatAST::VariableDecl& decl = ast.variableDecl(node);
+        const string& name = ast.str(decl.name);
         
-        // 分析返回值表达式
-        if (returnStmt->returnValue) {
-            analyzeExpression(returnStmt->returnValue);
+        if (!symbolTable.declareVariable(name, decl.varType, decl.isArray, decl.arraySize)) {
+            errors.push_back(SemanticError("变量 '" + name + "' 重复声明", ast.line[node], ast.column[node]));
         }
         
-        // TODO: 可以在这里添加返回类型检查，确保返回值类型与函数返回类型匹配
+        if (decl.initializer != FlatAST::NONE) {
+            DataType initType = analyzeExpression(ast, decl.initializer);
+            if (initType != DataType::UNKNOWN && initType != decl.varType) {
+                errors.push_back(SemanticError("变量 '" + name + "' 初始化类型不匹配", ast.line[node], ast.column[node]));
+            }
+        }
     }
     
-    // 分析表达式
-    DataType analyzeExpression(shared_ptr<ExpressionNode> expr) {
-        if (!expr) return DataType::UNKNOWN;
+    DataType analyzeExpression(const FlatAST& ast, FlatAST::Index node) {
+        if (node == FlatAST::NONE) return DataType::UNKNOWN;
         
-        switch (expr->type) {
+        switch (ast.kind[node]) {
             case NodeType::IDENTIFIER: {
-                auto id = static_pointer_cast<IdentifierNode>(expr);
-                if (!symbolTable.isDeclared(id->name)) {
-                    errors.push_back(SemanticError("变量 '" + id->name + "' 未声明", id->line, id->column));
+                const string& name = ast.str(ast.data[node]);
+                if (!symbolTable.isDeclared(name)) {
+                    errors.push_back(SemanticError("变量 '" + name + "' 未声明", ast.line[node], ast.column[node]));
                     return DataType::UNKNOWN;
                 }
-                return symbolTable.getType(id->name);
-            }
-            case NodeType::LITERAL: {
-                auto lit = static_pointer_cast<LiteralNode>(expr);
-                return lit->dataType;
+                return symbolTable.getType(name);
             }
+            case NodeType::LITERAL:
+                return ast.dataType[node];
             case NodeType::BINARY_OP: {
-                auto binOp = static_pointer_cast<BinaryOpNode>(expr);
-                DataType leftType = analyzeExpression(binOp->left);
-                DataType rightType = analyzeExpression(binOp->right);
+                const FlatAST::BinaryOp& binOp = ast.binaryOp(node);
+                DataType leftType = analyzeExpression(ast, binOp.left);
+                DataType rightType = analyzeExpression(ast, binOp.right);
                 
                 if (leftType != DataType::UNKNOWN && rightType != DataType::UNKNOWN && leftType != rightType) {
-                    errors.push_back(SemanticError("二元操作类型不匹配", binOp->line, binOp->column));
+                    errors.push_back(SemanticError("二元操作类型不匹配", ast.line[node], ast.column[node]));
                 }
                 
-                // 关系操作返回int类型（布尔值）
-                if (binOp->op == "<" || binOp->op == "<=" || binOp->op == "==" || 
-                    binOp->op == ">" || binOp->op == ">=" || binOp->op == "!=") {
+                const string& op = ast.str(binOp.op);
+                if (op == "<" || op == "<=" || op == "==" || op == ">" || op == ">=" || op == "!=") {
                     return DataType::INT;
                 }
-                
                 return leftType;
             }
             case NodeType::FUNCTION_CALL: {
-                auto call = static_pointer_cast<FunctionCallNode>(expr);
-                SymbolEntry* func = symbolTable.lookup(call->functionName);
+                const FlatAST::FunctionCall& call = ast.functionCall(node);
+                const string& name = ast.str(call.name);
+                SymbolEntry* func = symbolTable.lookup(name);
                 if (!func || !func->isFunction) {
-                    errors.push_back(SemanticError("函数 '" + call->functionName + "' 未声明", call->line, call->column));
+                    errors.push_back(SemanticError("函数 '" + name + "' 未声明", ast.line[node], ast.column[node]));
                     return DataType::UNKNOWN;
                 }
                 
-                // 检查参数个数
-                if (call->arguments.size() != func->paramTypes.size()) {
-                    errors.push_back(SemanticError("函数 '" + call->functionName + "' 参数个数不匹配", call->line, call->column));
+                if (call.arguments.count != func->paramTypes.size()) {
+                    errors.push_back(SemanticError("函数 '" + name + "' 参数个数不匹配", ast.line[node], ast.column[node]));
                 }
                 
-                // 检查参数类型
-                for (size_t i = 0; i < min(call->arguments.size(), func->paramTypes.size()); i++) {
-                    DataType argType = analyzeExpression(call->arguments[i]);
+                for (size_t i = 0; i < min<size_t>(call.arguments.count, func->paramTypes.size()); i++) {
+                    DataType argType = analyzeExpression(ast, ast.child(call.arguments, i));
                     if (argType != DataType::UNKNOWN && argType != func->paramTypes[i]) {
-                        errors.push_back(SemanticError("函数 '" + call->functionName + "' 第" + to_string(i+1) + "个参数类型不匹配", call->line, call->column));
+                        errors.push_back(SemanticError("函数 '" + name + "' 第" + to_string(i+1) + "个参数类型不匹配", ast.line[node], ast.column[node]));
                     }
                 }
                 
@@ -1440,719 +2696,1125 @@ public:
 
 
 // ===== SLR分析器 =====
+// 分析栈中一段连续元素的视图，归约时作为语义动作的参数，不必复制出临时vector
+template <typename T>
+class StackSpan {
+    T* first;
+    size_t count;
+public:
+    StackSpan(T* first, size_t count) : first(first), count(count) {}
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T& operator[](size_t i) const { return first[i]; }
+    T& back() const { return first[count - 1]; }
+};
+typedef StackSpan<const shared_ptr<ASTNode>> NodeSpan;
+
 class SLRParser {
+public:
+    // 分析统计
+    struct ParseStats {
+        size_t shifts = 0;
+        size_t reductions = 0;             // 实际执行的归约次数
+        size_t passThroughReductions = 0;  // 其中直通处理的归约：只换栈顶状态，不调用语义动作
+        size_t skippedReductions = 0;      // 单产生式消除省去、没有执行的归约次数
+        int bypassedStates = 0;            // 单产生式消除跳过其归约的状态数
+    };
+    
+    // 增量分析中可复用的子树：建成后不再被修改的语句或声明节点，连同它覆盖的记号区间、
+    // 开始分析它时的栈顶状态（左侧状态）和它的非终结符。记号区间、其后的一个记号和
+    // 左侧状态都相同时，重新分析必然得到同样的子树，可以直接拿来用
+    struct Subtree {
+        size_t first, last;   // 记号区间[first, last)
+        int leftState;
+        int symbol;
+        shared_ptr<ASTNode> node;
+    };
+    
+    // 一次增量分析的输入和输出，见 parseIncremental
+    struct ReuseContext {
+        vector<Subtree> reusable;   // 上次的子树，已换算到新记号流中的位置；按first升序、同first时外层在前
+        vector<Subtree> recorded;   // 本次分析得到的子树（包括复用的）
+        size_t reused = 0;          // 复用的子树数
+        size_t cursor = 0;          // reusable中第一个first不小于当前记号的子树
+        size_t next = 0;            // 下一个要取的记号
+        
+        // 从tokenIndex开始、左侧状态为state的子树，没有时返回nullptr
+        const Subtree* find(size_t tokenIndex, int state) {
+            while (cursor < reusable.size() && reusable[cursor].first < tokenIndex) cursor++;
+            for (size_t i = cursor; i < reusable.size() && reusable[i].first == tokenIndex; ++i) {
+                if (reusable[i].leftState == state) return &reusable[i];
+            }
+            return nullptr;
+        }
+        
+        // 复用tree：它和嵌套在其中的子树原样记入recorded，留给下一次分析
+        void take(const Subtree& tree) {
+            size_t last = tree.last;
+            recorded.push_back(tree);
+            reused++;
+            while (cursor < reusable.size() && reusable[cursor].first < last) {
+                const Subtree& inner = reusable[cursor];
+                if (&inner != &tree && inner.last <= last) recorded.push_back(inner);
+                cursor++;
+            }
+        }
+    };
+
 private:
-    SLRTable table;
+    // 语义动作：由右部各符号的节点构造左部的节点
+    typedef shared_ptr<ASTNode> (SLRParser::*SemanticAction)(NodeSpan children);
+    
+    ParseTable table;
+    unique_ptr<LazySLRTable> lazyTable;  // 非空时按需构造状态，table只提供符号编号
+    ErrorHandler* errorHandler = nullptr;  // 非空时语法错误报告给它，否则输出到cerr
+    bool failFast = false;      // 遇到第一个语法错误即放弃，不报告也不恢复（并行分析的工作分析器）
+    vector<int> tokenTerminal;  // TokenType -> 终结符编号，-1 表示文法中没有该终结符
+    // 分析栈在多次分析间保留容量，稳定状态下移进和归约不再分配内存
+    static const size_t STACK_RESERVE = 256;
     vector<int> stateStack;
-    vector<shared_ptr<ASTNode>> nodeStack;
-    vector<string> productions;
+    vector<shared_ptr<ASTNode>> nodeStack;   // 与状态栈（除底部的0状态外）一一对应，无值的终结符为nullptr
+    vector<int> scratchStack;                // 错误恢复时模拟归约用
+    vector<size_t> startStack;               // 增量分析时与节点栈对应，各符号的第一个记号的下标
+    ReuseContext* reuse = nullptr;           // 非空时为增量分析
+    bool unitElimination;       // 是否跳过直通单产生式的归约
+    // 按产生式编号索引的归约信息，由文法导出
+    vector<int> productionLhs;           // 左部非终结符编号
+    vector<int> productionRhsLength;     // 右部长度
+    vector<SemanticAction> actions;      // 语义动作，nullptr 表示文法中的这条产生式没有绑定动作
+    vector<char> passThrough;            // 是否按直通单产生式处理
+    vector<char> reusableSymbol;         // 按非终结符编号，增量分析时是否记录为可复用子树
+    vector<string> productionSignatures; // 产生式签名，供 translate 的语义绑定动作
+    ParseStats stats;
     
 public:
-    SLRParser() {
-        loadSLRTable();
+    // loadBuiltinTable为false时不装入构建时生成的分析表，由调用者随后装入其他文法的表
+    explicit SLRParser(bool eliminateUnitReductions = true, bool loadBuiltinTable = true)
+        : unitElimination(eliminateUnitReductions) {
+        if (loadBuiltinTable) loadSLRTable();
     }
     
+    // 复制出并行分析用的工作分析器：分析表和产生式信息为副本，分析栈和统计各自独立。
+    // 按需构造的表在分析中会被修改，不能跨线程共享，因此不复制lazyTable和errorHandler
+    SLRParser(const SLRParser& other)
+        : table(other.table), tokenTerminal(other.tokenTerminal), unitElimination(other.unitElimination),
+          productionLhs(other.productionLhs), productionRhsLength(other.productionRhsLength),
+          actions(other.actions), passThrough(other.passThrough), reusableSymbol(other.reusableSymbol),
+          productionSignatures(other.productionSignatures),
+          stats(other.stats) {}
+    
+    const ParseStats& getStats() const { return stats; }
+    const LazySLRTable* getLazyTable() const { return lazyTable.get(); }
+    void setErrorHandler(ErrorHandler* handler) { errorHandler = handler; }
+    
     void loadSLRTable() {
-        // 加载产生式规则
-        productions = {
-            "S' -> Prog",
-            "Prog -> DeclList",
-            "DeclList -> DeclList Decl",
-            "DeclList -> Decl",
-            "Decl -> VarDecl",
-            "Decl -> FunDecl",
-            "VarDecl -> Type ID SEMI",
-            "VarDecl -> Type ID LBRACK INT_NUM RBRACK SEMI",
-            "VarDecl -> Type ID ASG Expr SEMI",
-            "Type -> INT",
-            "Type -> FLOAT",
-            "Type -> VOID",
-            "FunDecl -> Type ID LPAR ParamList RPAR CompStmt",
-            "ParamList -> ParamList COMMA Param",
-            "ParamList -> Param",
-            "ParamList -> ε",
-            "Param -> Type ID",
-            "Param -> Type ID LBRACK RBRACK",
-            "CompStmt -> LBR StmtList RBR",
-            "StmtList -> StmtList Stmt",
-            "StmtList -> ε",
-            "Stmt -> VarDecl",
-            "Stmt -> OtherStmt",
-            "OtherStmt -> ExprStmt",
-            "OtherStmt -> CompStmt",
-            "OtherStmt -> IfStmt",
-            "OtherStmt -> LoopStmt",
-            "OtherStmt -> RetStmt",
-            "OtherStmt -> PrintStmt",
-            "PrintStmt -> PRINT LPAR Expr RPAR SEMI",
-            "ExprStmt -> Expr SEMI",
-            "ExprStmt -> SEMI",
-            "IfStmt -> IF LPAR Expr RPAR CompStmt",
-            "IfStmt -> IF LPAR Expr RPAR CompStmt ELSE Stmt",
-            "LoopStmt -> WHILE LPAR Expr RPAR Stmt",
-            "RetStmt -> RETURN Expr SEMI",
-            "RetStmt -> RETURN SEMI",
-            "Expr -> ID ASG Expr",
-            "Expr -> ID LBRACK Expr RBRACK ASG Expr",
-            "Expr -> ID LPAR ArgList RPAR",
-            "Expr -> SimpExpr",
-            "SimpExpr -> AddExpr REL_OP AddExpr",
-            "SimpExpr -> AddExpr",
-            "AddExpr -> AddExpr ADD Term",
-            "AddExpr -> Term",
-            "Term -> Term MUL Fact",
-            "Term -> Fact",
-            "Fact -> ID",
-            "Fact -> ID LBRACK Expr RBRACK",
-            "Fact -> INT_NUM",
-            "Fact -> FLOAT_NUM",
-            "Fact -> LPAR Expr RPAR",
-            "ArgList -> ArgList COMMA Expr",
-            "ArgList -> Expr",
-            "ArgList -> ε"
-        };
-        
-        // 加载SLR分析表
-        vector<string> rules = {
-            "Prog -> DeclList",
-            "DeclList -> DeclList Decl | Decl",
-            "Decl -> VarDecl | FunDecl",
-            "VarDecl -> Type ID SEMI | Type ID LBRACK INT_NUM RBRACK SEMI | Type ID ASG Expr SEMI",
-            "Type -> INT | FLOAT | VOID",
-            "FunDecl -> Type ID LPAR ParamList RPAR CompStmt",
-            "ParamList -> ParamList COMMA Param | Param | ε",
-            "Param -> Type ID | Type ID LBRACK RBRACK",
-            "CompStmt -> LBR StmtList RBR",
-            "StmtList -> StmtList Stmt | ε",
-            "Stmt -> VarDecl | OtherStmt",
-            "OtherStmt -> ExprStmt | CompStmt | IfStmt | LoopStmt | RetStmt | PrintStmt",
-            "PrintStmt -> PRINT LPAR Expr RPAR SEMI",
-            "ExprStmt -> Expr SEMI | SEMI",
-            "IfStmt -> IF LPAR Expr RPAR CompStmt | IF LPAR Expr RPAR CompStmt ELSE Stmt",
-            "LoopStmt -> WHILE LPAR Expr RPAR Stmt",
-            "RetStmt -> RETURN Expr SEMI | RETURN SEMI",
-            "Expr -> ID ASG Expr | ID LBRACK Expr RBRACK ASG Expr | ID LPAR ArgList RPAR | SimpExpr",
-            "SimpExpr -> AddExpr REL_OP AddExpr | AddExpr",
-            "AddExpr -> AddExpr ADD Term | Term",
-            "Term -> Term MUL Fact | Fact",
-            "Fact -> ID | ID LBRACK Expr RBRACK | INT_NUM | FLOAT_NUM | LPAR Expr RPAR",
-            "ArgList -> ArgList COMMA Expr | Expr | ε"
-        };
+        // 分析表由 slr_table_gen 在构建时根据 lab3/grammar.txt 生成（lab3/slr_table.h），
+        // 生成时已经压缩好，这里直接指向其中的常量数组，不复制也不重新压缩
+        lazyTable.reset();
+        table = ParseTable();
+        table.state_count = SLR_STATE_COUNT;
+        table.terminals = SymbolIndex(TableArray<const char*>(SLR_TERMINALS), TableArray<int32_t>(SLR_TERMINAL_ORDER));
+        table.nonterminals = SymbolIndex(TableArray<const char*>(SLR_NONTERMINALS),
+                                         TableArray<int32_t>(SLR_NONTERMINAL_ORDER));
+        table.compressed = true;
+        table.default_action = TableArray<int16_t>(SLR_DEFAULT_ACTION);
+        table.action_base = TableArray<int32_t>(SLR_ACTION_BASE);
+        table.action_value = TableArray<int16_t>(SLR_ACTION_VALUE);
+        table.action_check = TableArray<int16_t>(SLR_ACTION_CHECK);
+        table.default_goto = TableArray<int16_t>(SLR_DEFAULT_GOTO);
+        table.goto_base = TableArray<int32_t>(SLR_GOTO_BASE);
+        table.goto_value = TableArray<int16_t>(SLR_GOTO_VALUE);
+        table.goto_check = TableArray<int16_t>(SLR_GOTO_CHECK);
+        table.sole_reduction = TableArray<int16_t>(SLR_SOLE_REDUCTION);
+        bindProductions(vector<string>(SLR_PRODUCTIONS, SLR_PRODUCTIONS + SLR_PRODUCTION_COUNT),
+                        vector<int>(SLR_PRODUCTION_LHS, SLR_PRODUCTION_LHS + SLR_PRODUCTION_COUNT),
+                        vector<int>(SLR_PRODUCTION_RHS_LENGTH, SLR_PRODUCTION_RHS_LENGTH + SLR_PRODUCTION_COUNT));
+        buildTokenMap();
 
+        if (DEBUG_MODE) {
+            // 调试模式下按生成时的文法重新构造一遍，用于打印项目集和分析表
+            Grammar g;
+            g.parse(vector<string>(SLR_RULES, SLR_RULES + SLR_RULE_COUNT));
+            g.compute_first();
+            g.compute_follow();
+            CanonicalCollection cc = build_canonical_collection(g);
+            SLRTable slr = build_slr_table(g, cc);
+            g.print_grammar();  // 打印语法规则，查看产生式编号
+            print_canonical_collection(cc, g);
+            print_slr_table(slr, g, cc.C.size());
+            print_parse_table_stats(table);
+        }
+        
+    }
+    
+    // 按需构造分析表：只预先计算FIRST/FOLLOW集，状态在分析中第一次到达时才构造，
+    // 短小的输入只需为用到的那部分文法付出构造代价。默认使用构建时的文法。
+    void loadLazySLRTable() {
+        loadLazySLRTable(vector<string>(SLR_RULES, SLR_RULES + SLR_RULE_COUNT));
+    }
+    
+    void loadLazySLRTable(const vector<string>& rules) {
         Grammar g;
         g.parse(rules);
         g.compute_first();
         g.compute_follow();
-        CanonicalCollection cc = build_canonical_collection(g);
-        table = build_slr_table(g, cc);
-
-
-        if (DEBUG_MODE) {
-            g.print_grammar();  // 打印语法规则，查看产生式编号
-            print_canonical_collection(cc, g);
-            print_slr_table(table, g, cc.C.size());
+        lazyTable.reset(new LazySLRTable(g));
+        table = ParseTable();
+        table.terminals = SymbolIndex(lazyTable->terminals);
+        table.nonterminals = SymbolIndex(lazyTable->nonterminals);
+        // 没有稠密表可改写，单产生式只在分析时直通
+        bindProductions(g);
+        buildTokenMap();
+    }
+    
+    // 使用自定义文法构造分析表（用于文法实验），cacheDir非空时使用分析表缓存，
+    // 文法未变时直接载入上次的结果。语义动作按产生式签名绑定，产生式可以调整顺序。
+    void loadSLRTable(const vector<string>& rules, const string& cacheDir) {
+        lazyTable.reset();
+        Grammar g;
+        SLRTable slr;
+        if (!cacheDir.empty()) {
+            // 命中缓存时分析表直接指向映射的缓存文件，没有SLR分析表可打印
+            build_parse_table_cached(rules, cacheDir, g, table, slr);
+        } else {
+            g.parse(rules);
+            g.compute_first();
+            g.compute_follow();
+            CanonicalCollection cc = build_canonical_collection(g);
+            slr = build_slr_table(g, cc);
+            table = build_parse_table(g, slr, cc.C.size());
+            table.compress();
         }
+        bindProductions(g);
+        buildTokenMap();
         
+        if (DEBUG_MODE) {
+            if (!slr.ACTION.empty()) print_slr_table(slr, g, table.state_count);
+            print_parse_table_stats(table);
+        }
     }
     
+    // 分析文件并输出记号和AST树形结构
     shared_ptr<ASTNode> parse(const string& filename) {
         Lexer lexer(filename);
-        vector<Token> tokens;
         cout << "start parse" << endl;
-        // 词法分析
+        auto ast = parse(lexer, true);
+        if (ast) {
+            cout << "\n=== AST结构 ===" << endl;
+            ast->printTree();
+        }
+        return ast;
+    }
+    
+    // 静默的流式分析：边分析边从词法分析器逐行取记号，不输出记号和AST、不写文件，
+    // 只有语法错误会输出到cerr
+    shared_ptr<ASTNode> parseQuiet(const string& filename) {
+        Lexer lexer(filename, true);
+        return parse(lexer, false);
+    }
+    
+    // 只做语法检查的结果：accepted为false时line/token给出第一个语法错误的位置
+    struct ValidationResult {
+        bool accepted = false;
+        int line = 0;
+        string token;
+    };
+    
+    // 只运行移进/归约自动机检查文件是否符合文法：只维护状态栈，
+    // 不创建任何节点、不调用语义动作，遇到第一个错误即停止
+    ValidationResult validate(const string& filename) {
+        Lexer lexer(filename, true);
+        ValidationResult result;
         Token token;
-        do {
-            token = lexer.getNextToken();
-            tokens.push_back(token);
-            cout << "token: " << token.value << " (type: " << tokenTypeToString(token.type) << ")" << endl;
-        } while (lexer.getPos() < lexer.getTokensSize());
-        
-        // 添加EOF token
-        Token eofToken;
-        eofToken.type = TokenType::EOF_TOKEN;
-        eofToken.value = "$";
-        tokens.push_back(eofToken);
-        cout << "token: " << eofToken.value << " (type: " << tokenTypeToString(eofToken.type) << ")" << endl;
+        bool atEnd = false;
+        auto advance = [&]() {
+            if (!lexer.next(token)) {
+                token.type = TokenType::EOF_TOKEN;
+                token.value = "$";
+                token.line = 0;
+                atEnd = true;
+            }
+        };
         
-        // 语法分析
         stateStack.clear();
-        nodeStack.clear();
-        stateStack.push_back(0);  // 初始状态
-        
-        size_t tokenIndex = 0;
-        
-        while (tokenIndex < tokens.size()) {
-            int state = stateStack.back();
-            Token currentToken = tokens[tokenIndex];
-            string symbol = tokenTypeToString(currentToken.type);
-            
-            // 将EOF_TOKEN转换为#符号
-            if (symbol == "EOF_TOKEN") {
-                symbol = "#";
-            }
-            
-            DEBUG_PRINT(cout << "处理token[" << tokenIndex << "]: " << symbol << " 在状态 " << state << endl);
-            
-            // 查找ACTION表
-            if (table.ACTION[state].count(symbol) == 0) {
-                cerr << "语法错误：状态 " << state << " 没有符号 " << symbol << " 的动作" << endl;
-                // 打印当前状态的所有ACTION条目
-                cerr << "状态 " << state << " 的ACTION条目：";
-                for (const auto& entry : table.ACTION[state]) {
-                    cerr << " " << entry.first << "->" << entry.second.type << entry.second.value;
-                }
-                cerr << endl;
-                return nullptr;
-            }
-            
-            SLRAction action = table.ACTION[state][symbol];
-
-            if (DEBUG_MODE) {
-                cout << "state: " << state << " symbol: " << symbol << " action: " << action.type << " " << action.value << endl;
-            }
-            
-            
+        stateStack.reserve(STACK_RESERVE);
+        stateStack.push_back(0);
+        advance();
+        while (true) {
+            int terminal = tokenTerminal[(int)token.type];
+            SLRAction action = decode_action(terminal < 0 ? 0 : actionAt(stateStack.back(), terminal));
             if (action.type == 's') {
-                // 移进
                 stateStack.push_back(action.value);
-                nodeStack.push_back(createTerminalNode(currentToken));
-                tokenIndex++;
+                if (atEnd) break;
+                advance();
             } else if (action.type == 'r') {
-                // 归约
-                int prodNum = action.value;
-                
-                // 获取产生式右部长度
-                int rightLength = getProductionRightLength(prodNum);
-                
-                // 弹出状态栈和节点栈
-                vector<shared_ptr<ASTNode>> children;
-                for (int i = 0; i < rightLength; i++) {
-                    if (!nodeStack.empty()) {
-                        children.push_back(nodeStack.back());
-                        nodeStack.pop_back();
-                    }
-                    if (!stateStack.empty()) {
-                        stateStack.pop_back();
-                    }
-                }
-                reverse(children.begin(), children.end());
-                
-                // 创建新节点
-                shared_ptr<ASTNode> newNode = createNodeFromProduction(prodNum, children);
-                if (!newNode) {
-                    cerr << "创建节点失败，产生式编号: " << prodNum << endl;
-                    return nullptr;
-                }
-                
-                // 获取产生式左部
-                string left = getProductionLeft(prodNum);
-                
-                // 查找GOTO表
-                state = stateStack.back();
-                if (table.GOTO[state].count(left) == 0) {
-                    cerr << "语法错误：GOTO[" << state << ", " << left << "] 未定义" << endl;
-                    // 打印当前状态的所有GOTO条目
-                    cerr << "状态 " << state << " 的GOTO条目：";
-                    for (const auto& entry : table.GOTO[state]) {
-                        cerr << " " << entry.first << "->" << entry.second;
-                    }
-                    cerr << endl;
-                    return nullptr;
-                }
-                
-                stateStack.push_back(table.GOTO[state][left]);
-                nodeStack.push_back(newNode);
+                stateStack.resize(stateStack.size() - productionRhsLength[action.value]);
+                int next = gotoAt(stateStack.back(), productionLhs[action.value]);
+                if (next < 0) break;
+                stateStack.push_back(next);
             } else if (action.type == 'a') {
-                // 接受
-                cout << "语法分析成功完成！" << endl;
-                if (!nodeStack.empty()) {
-                    auto ast = nodeStack.back();
-                    cout << "\n=== AST结构 ===" << endl;
-                    if (ast) {
-                        ast->printTree();
-                        saveASTtoJSON(ast, "ast.json");
-                    }
-                    return ast;
-                }
-                return nullptr;
+                result.accepted = true;
+                return result;
+            } else {
+                break;
             }
         }
+        result.line = token.line;
+        result.token = token.value;
+        return result;
+    }
+    
+    // 并行分析：Prog是互不相关的顶层声明序列，按花括号深度和顶层SEMI把记号流切成
+    // 一个个声明，由threadCount个线程各自分析一段连续的声明，再按源程序顺序拼接成
+    // 一个ProgramNode。单个声明本身就是合法的Prog，所以每个声明都从初始状态分析到接受。
+    // 任一声明有语法错误时退回顺序分析，由它报告错误并做恢复。与parseQuiet一样不输出记号和AST。
+    shared_ptr<ASTNode> parseParallel(const string& filename, int threadCount) {
+        if (threadCount <= 1 || lazyTable) return parseQuiet(filename);
+        vector<Token> tokens;
+        {
+            Lexer lexer(filename, true);
+            Token token;
+            while (lexer.next(token)) tokens.push_back(token);
+        }
+        vector<pair<size_t, size_t>> ranges = splitTopLevelDecls(tokens);
+        if (ranges.size() < 2) return parseQuiet(filename);
         
-        cout << "所有token处理完成，但没有遇到接受状态" << endl;
-        cout << "最终状态栈大小: " << stateStack.size() << endl;
-        cout << "最终节点栈大小: " << nodeStack.size() << endl;
-        if (!nodeStack.empty()) {
-            cout << "返回最后的节点" << endl;
-            return nodeStack.back();
+        // 按记号数把声明分成连续的若干组，每组工作量大致相当
+        int groups = min<int>(threadCount, ranges.size());
+        vector<size_t> groupBegin(groups + 1, ranges.size());
+        groupBegin[0] = 0;
+        for (size_t r = 0, g = 1; r < ranges.size() && g < (size_t)groups; ++r) {
+            if (ranges[r].first * groups >= tokens.size() * g) groupBegin[g++] = r;
         }
         
-        return nullptr;
+        vector<shared_ptr<ASTNode>> results(ranges.size());
+        vector<ParseStats> groupStats(groups);
+        vector<thread> workers;
+        for (int g = 0; g < groups; ++g) {
+            workers.emplace_back([&, g] {
+                SLRParser worker(*this);
+                worker.failFast = true;
+                ParseStats& total = groupStats[g];
+                for (size_t r = groupBegin[g]; r < groupBegin[g + 1]; ++r) {
+                    size_t next = ranges[r].first, last = ranges[r].second;
+                    results[r] = worker.parseTokens([&](Token& token) {
+                        if (next == last) return false;
+                        token = tokens[next++];
+                        return true;
+                    }, filename, false);
+                    if (!results[r]) break;
+                    total.shifts += worker.stats.shifts;
+                    total.reductions += worker.stats.reductions;
+                    total.passThroughReductions += worker.stats.passThroughReductions;
+                    total.skippedReductions += worker.stats.skippedReductions;
+                }
+            });
+        }
+        for (auto& w : workers) w.join();
+        
+        auto program = make_shared<ProgramNode>();
+        for (const auto& result : results) {
+            if (!result || result->type != NodeType::PROGRAM) {
+                DEBUG_PRINT(cout << "并行分析失败，改为顺序分析" << endl);
+                return parseQuiet(filename);
+            }
+            auto part = static_pointer_cast<ProgramNode>(result);
+            for (auto& var : part->globalVariables) program->addGlobalVariable(move(var));
+            for (auto& func : part->functions) program->addFunction(move(func));
+        }
+        int bypassedStates = stats.bypassedStates;
+        stats = ParseStats();
+        stats.bypassedStates = bypassedStates;
+        for (const auto& s : groupStats) {
+            stats.shifts += s.shifts;
+            stats.reductions += s.reductions;
+            stats.passThroughReductions += s.passThroughReductions;
+            stats.skippedReductions += s.skippedReductions;
+        }
+        return program;
     }
     
-private:
-    shared_ptr<ASTNode> createTerminalNode(const Token& token) {
-        switch (token.type) {
-            case TokenType::ID:
-                return make_shared<IdentifierNode>(token.value);
-            case TokenType::INT_NUM:
-                return make_shared<LiteralNode>(token.value, DataType::INT);
-            case TokenType::FLOAT_NUM:
-                return make_shared<LiteralNode>(token.value, DataType::FLOAT);
-            case TokenType::REL_OP:
-                // 关系操作符，创建一个字面量节点来保存操作符值
-                return make_shared<LiteralNode>(token.value, DataType::UNKNOWN);
-            case TokenType::ADD:
-                return make_shared<LiteralNode>("+", DataType::UNKNOWN);
-            case TokenType::MUL:
-                return make_shared<LiteralNode>("*", DataType::UNKNOWN);
-            default:
-                // 对于其他终结符，暂时返回nullptr或创建一个占位节点
-                return nullptr;
-        }
+    // 增量分析：分析tokens，遇到context.reusable中左侧状态相同的子树时直接压栈、跳过它的记号，
+    // 不再逐个移进归约。context.recorded为本次的子树（有语法错误时只到错误处为止），
+    // 供下一次使用。不输出记号和AST
+    shared_ptr<ASTNode> parseIncremental(const vector<Token>& tokens, const string& filename, ReuseContext& context) {
+        context.recorded.clear();
+        context.reused = context.cursor = context.next = 0;
+        reuse = &context;
+        auto ast = parseTokens([&](Token& token) {
+            if (context.next == tokens.size()) return false;
+            token = tokens[context.next++];
+            return true;
+        }, filename, false);
+        reuse = nullptr;
+        return ast;
     }
     
-    string getProductionLeft(int prodNum) {
-        // 根据SLR表构建时的产生式编号返回左部
-        switch(prodNum) {
-            case 0: return "S'";
-            case 1: return "Prog";
-            case 2: case 3: return "DeclList";
-            case 4: case 5: return "Decl";
-            case 6: case 7: case 8: return "VarDecl";
-            case 9: case 10: case 11: return "Type";
-            case 12: return "FunDecl";
-            case 13: case 14: case 15: return "ParamList";
-            case 16: case 17: return "Param";
-            case 18: return "CompStmt";
-            case 19: case 20: return "StmtList";
-            case 21: case 22: return "Stmt";
-            case 23: case 24: case 25: case 26: case 27: case 28: return "OtherStmt";
-            case 29: return "PrintStmt";
-            case 30: case 31: return "ExprStmt";
-            case 32: case 33: return "IfStmt";
-            case 34: return "LoopStmt";
-            case 35: case 36: return "RetStmt";
-            case 37: case 38: case 39: case 40: return "Expr";
-            case 41: case 42: return "SimpExpr";
-            case 43: case 44: return "AddExpr";
-            case 45: case 46: return "Term";
-            case 47: case 48: case 49: case 50: case 51: return "Fact";
-            case 52: case 53: case 54: return "ArgList";
-            default: return "";
-        }
-    }
-    
-    int getProductionRightLength(int prodNum) {
-        // 根据实际的产生式编号返回右部长度
-        switch(prodNum) {
-            case 0: return 1; // S' → Prog
-            case 1: return 1; // Prog → DeclList
-            case 2: return 2; // DeclList → DeclList Decl
-            case 3: return 1; // DeclList → Decl
-            case 4: return 1; // Decl → VarDecl
-            case 5: return 1; // Decl → FunDecl
-            case 6: return 3; // VarDecl → Type ID SEMI
-            case 7: return 6; // VarDecl → Type ID LBRACK INT_NUM RBRACK SEMI
-            case 8: return 5; // VarDecl → Type ID ASG Expr SEMI
-            case 9: return 1; // Type → INT
-            case 10: return 1; // Type → FLOAT
-            case 11: return 1; // Type → VOID
-            case 12: return 6; // FunDecl → Type ID LPAR ParamList RPAR CompStmt
-            case 13: return 3; // ParamList → ParamList COMMA Param
-            case 14: return 1; // ParamList → Param
-            case 15: return 0; // ParamList → ε
-            case 16: return 2; // Param → Type ID
-            case 17: return 4; // Param → Type ID LBRACK RBRACK
-            case 18: return 3; // CompStmt → LBR StmtList RBR
-            case 19: return 2; // StmtList → StmtList Stmt
-            case 20: return 0; // StmtList → ε
-            case 21: return 1; // Stmt → VarDecl
-            case 22: return 1; // Stmt → OtherStmt
-            case 23: return 1; // OtherStmt → ExprStmt
-            case 24: return 1; // OtherStmt → CompStmt
-            case 25: return 1; // OtherStmt → IfStmt
-            case 26: return 1; // OtherStmt → LoopStmt
-            case 27: return 1; // OtherStmt → RetStmt
-            case 28: return 1; // OtherStmt → PrintStmt
-            case 29: return 5; // PrintStmt → PRINT LPAR Expr RPAR SEMI
-            case 30: return 2; // ExprStmt → Expr SEMI
-            case 31: return 1; // ExprStmt → SEMI
-            case 32: return 5; // IfStmt → IF LPAR Expr RPAR CompStmt
-            case 33: return 7; // IfStmt → IF LPAR Expr RPAR CompStmt ELSE CompStmt
-            case 34: return 5; // LoopStmt → WHILE LPAR Expr RPAR Stmt
-            case 35: return 3; // RetStmt → RETURN Expr SEMI
-            case 36: return 2; // RetStmt → RETURN SEMI
-            case 37: return 3; // Expr → ID ASG Expr
-            case 38: return 6; // Expr → ID LBRACK Expr RBRACK ASG Expr
-            case 39: return 4; // Expr → ID LPAR ArgList RPAR
-            case 40: return 1; // Expr → SimpExpr
-            case 41: return 3; // SimpExpr → AddExpr REL_OP AddExpr
-            case 42: return 1; // SimpExpr → AddExpr
-            case 43: return 3; // AddExpr → AddExpr ADD Term
-            case 44: return 1; // AddExpr → Term
-            case 45: return 3; // Term → Term MUL Fact
-            case 46: return 1; // Term → Fact
-            case 47: return 1; // Fact → ID
-            case 48: return 4; // Fact → ID LBRACK Expr RBRACK
-            case 49: return 1; // Fact → INT_NUM
-            case 50: return 1; // Fact → FLOAT_NUM
-            case 51: return 3; // Fact → LPAR Expr RPAR
-            case 52: return 3; // ArgList → ArgList COMMA Expr
-            case 53: return 1; // ArgList → Expr
-            case 54: return 0; // ArgList → ε
-            default: return 0;
-        }
-    }
-    
-    shared_ptr<ASTNode> createNodeFromProduction(int prodNum, const vector<shared_ptr<ASTNode>>& children) {
-        // 根据产生式编号创建对应的AST节点
-        // 每个case对应一个语法产生式规则
-        switch(prodNum) {
-            case 0: // S' -> Prog (增广文法的开始符号)
-                return children.empty() ? nullptr : children[0];
-            
-            case 1: // Prog -> DeclList (程序由声明列表组成)
-                return children.empty() ? nullptr : children[0];
-            
-            case 2: { // DeclList -> DeclList Decl
-                if (children.size() < 2) return nullptr;
-                auto program = static_pointer_cast<ProgramNode>(children[0]);
-                auto decl = children[1];
-                
-                if (decl->type == NodeType::VARIABLE_DECL) {
-                    program->addGlobalVariable(static_pointer_cast<VariableDeclNode>(decl));
-                } else if (decl->type == NodeType::FUNCTION_DEF) {
-                    program->addFunction(static_pointer_cast<FunctionDefNode>(decl));
-                }
-                
-                return program;
-            }
-            
-            case 3: { // DeclList -> Decl
-                if (children.empty()) return nullptr;
-                auto program = make_shared<ProgramNode>();
-                auto decl = children[0];
-                
-                if (decl->type == NodeType::VARIABLE_DECL) {
-                    program->addGlobalVariable(static_pointer_cast<VariableDeclNode>(decl));
-                } else if (decl->type == NodeType::FUNCTION_DEF) {
-                    program->addFunction(static_pointer_cast<FunctionDefNode>(decl));
-                }
-                
-                return program;
-            }
-            
-            case 4: // Decl -> VarDecl
-            case 5: // Decl -> FunDecl
-                return children.empty() ? nullptr : children[0];
-            
-            case 6: { // VarDecl -> Type ID SEMI
-                if (children.size() < 3) return nullptr;
-                DataType varType = getDataTypeFromNode(children[0]);
-                string varName = getIdentifierName(children[1]);
-                return make_shared<VariableDeclNode>(varType, varName);
-            }
-            
-            case 7: { // VarDecl -> Type ID LBRACK INT_NUM RBRACK SEMI
-                if (children.size() < 6) return nullptr;
-                DataType baseType = getDataTypeFromNode(children[0]);
-                string varName = getIdentifierName(children[1]);
-                int arraySize = stoi(getLiteralValue(children[3]));
-                
-                DataType arrayType = (baseType == DataType::INT) ? DataType::ARRAY_INT : DataType::ARRAY_FLOAT;
-                auto varDecl = make_shared<VariableDeclNode>(arrayType, varName);
-                varDecl->isArray = true;
-                varDecl->arraySize = arraySize;
-                
-                return varDecl;
-            }
-            
-            case 8: { // VarDecl -> Type ID ASG Expr SEMI
-                if (children.size() < 5) return nullptr;
-                DataType varType = getDataTypeFromNode(children[0]);
-                string varName = getIdentifierName(children[1]);
-                auto initExpr = static_pointer_cast<ExpressionNode>(children[3]);
-                
-                return make_shared<VariableDeclNode>(varType, varName, initExpr);
-            }
-            
-            case 9: // Type -> INT
-                return make_shared<LiteralNode>("int", DataType::INT);
-            
-            case 10: // Type -> FLOAT
-                return make_shared<LiteralNode>("float", DataType::FLOAT);
-            
-            case 11: // Type -> VOID
-                return make_shared<LiteralNode>("void", DataType::VOID);
-            
-            case 12: { // FunDecl -> Type ID LPAR ParamList RPAR CompStmt
-                if (children.size() < 6) return nullptr;
-                DataType returnType = getDataTypeFromNode(children[0]);
-                string funcName = getIdentifierName(children[1]);
-                auto paramList = children[3]; // ParamList节点
-                auto body = static_pointer_cast<CompoundStmtNode>(children[5]);
-                
-                auto func = make_shared<FunctionDefNode>(returnType, funcName);
-                func->body = body;
-                
-                // 处理参数列表
-                auto params = getParameterList(paramList);
-                for (auto param : params) {
-                    func->addParameter(param);
-                }
-                
-                return func;
-            }
-            
-            case 13: { // ParamList -> ParamList COMMA Param
-                if (children.size() < 3) return nullptr;
-                // 创建参数列表节点（使用CompoundStmtNode临时表示）
-                auto paramList = make_shared<CompoundStmtNode>();
-                auto existingParams = getParameterList(children[0]);
-                auto newParam = static_pointer_cast<VariableDeclNode>(children[2]);
-                
-                // 添加现有参数
-                for (auto param : existingParams) {
-                    paramList->addStatement(param);
-                }
-                // 添加新参数
-                paramList->addStatement(newParam);
-                
-                return paramList;
-            }
-            
-            case 14: { // ParamList -> Param
-                if (children.empty()) return nullptr;
-                // 创建只包含一个参数的参数列表
-                auto paramList = make_shared<CompoundStmtNode>();
-                auto param = static_pointer_cast<VariableDeclNode>(children[0]);
-                paramList->addStatement(param);
-                return paramList;
-            }
-            
-            case 15: { // ParamList -> ε (空产生式)
-                // 返回一个空的复合语句节点来表示空参数列表
-                return make_shared<CompoundStmtNode>();
-            }
-            
-            case 16: { // Param -> Type ID
-                if (children.size() < 2) return nullptr;
-                DataType paramType = getDataTypeFromNode(children[0]);
-                string paramName = getIdentifierName(children[1]);
-                return make_shared<VariableDeclNode>(paramType, paramName);
-            }
-            
-            case 17: { // Param -> Type ID LBRACK RBRACK
-                if (children.size() < 4) return nullptr;
-                DataType baseType = getDataTypeFromNode(children[0]);
-                string paramName = getIdentifierName(children[1]);
-                DataType arrayType = (baseType == DataType::INT) ? DataType::ARRAY_INT : DataType::ARRAY_FLOAT;
-                auto param = make_shared<VariableDeclNode>(arrayType, paramName);
-                param->isArray = true;
-                return param;
-            }
-            
-            case 18: { // CompStmt -> LBR StmtList RBR
-                if (children.size() < 3) return nullptr;
-                return children[1]; // 返回StmtList
-            }
-            
-            case 19: { // StmtList -> StmtList Stmt
-                if (children.size() < 2) return nullptr;
-                auto stmtList = static_pointer_cast<CompoundStmtNode>(children[0]);
-                auto stmt = static_pointer_cast<StatementNode>(children[1]);
-                stmtList->addStatement(stmt);
-                return stmtList;
-            }
-            
-            case 20: { // StmtList -> ε (空产生式)
-                return make_shared<CompoundStmtNode>();
-            }
-            
-            case 21: // Stmt -> VarDecl
-            case 22: // Stmt -> OtherStmt
-            case 23: // OtherStmt -> ExprStmt
-            case 24: // OtherStmt -> CompStmt
-            case 25: // OtherStmt -> IfStmt
-            case 26: // OtherStmt -> LoopStmt
-            case 27: // OtherStmt -> RetStmt
-                return children.empty() ? nullptr : children[0];
-            
-            case 28: { // ExprStmt -> Expr SEMI
-                if (children.size() < 2) return nullptr;
-                return children[0]; // 返回表达式
-            }
-            
-            case 29: { // ExprStmt -> SEMI
-                return nullptr; // 空语句
-            }
-            
-            case 30: { // ExprStmt -> Expr SEMI
-                if (children.size() < 2) return nullptr;
-                return children[0]; // 返回表达式
-            }
-            
-            case 31: { // ExprStmt -> SEMI
-                return nullptr; // 空语句
-            }
-            
-            case 32: { // IfStmt -> IF LPAR Expr RPAR CompStmt
-                if (children.size() < 5) return nullptr;
-                auto condition = static_pointer_cast<ExpressionNode>(children[2]);
-                auto thenStmt = static_pointer_cast<StatementNode>(children[4]);
-                return make_shared<IfStmtNode>(condition, thenStmt);
+    // 语法制导翻译：按同一张分析表移进和归约，但不构造AST，栈上是由semantics计算的属性。
+    // Semantics 需要提供：
+    //   Value                                    文法符号的属性类型
+    //   void bind(const vector<string>& sigs)   按产生式签名绑定各产生式的翻译动作
+    //   void shift(const Token&, StackSpan<Value> stack, Value& value)
+    //   void reduce(int prod, StackSpan<Value> below, StackSpan<Value> children, Value& result)
+    // 单产生式消除跳过的归约（见 bindProductions）对属性也必须是原样传递。
+    // 遇到第一个语法错误即报告并停止，返回输入是否被接受
+    template <typename Semantics>
+    bool translate(const string& filename, Semantics& semantics) {
+        typedef typename Semantics::Value Value;
+        semantics.bind(productionSignatures);
+        Lexer lexer(filename, true);
+        Token token;
+        bool atEnd = false;
+        auto advance = [&]() {
+            if (!lexer.next(token)) {
+                token = Token();
+                token.type = TokenType::EOF_TOKEN;
+                token.value = "$";
+                token.line = 0;
+                atEnd = true;
             }
-            
-            case 33: { // IfStmt -> IF LPAR Expr RPAR CompStmt ELSE CompStmt
-                if (children.size() < 7) return nullptr;
-                auto condition = static_pointer_cast<ExpressionNode>(children[2]);
-                auto thenStmt = static_pointer_cast<StatementNode>(children[4]);
-                auto elseStmt = static_pointer_cast<StatementNode>(children[6]);
-                return make_shared<IfStmtNode>(condition, thenStmt, elseStmt);
+        };
+        
+        vector<Value> values;
+        values.reserve(STACK_RESERVE);
+        stateStack.clear();
+        stateStack.reserve(STACK_RESERVE);
+        stateStack.push_back(0);
+        advance();
+        while (true) {
+            int state = stateStack.back();
+            int terminal = tokenTerminal[(int)token.type];
+            SLRAction action = decode_action(terminal < 0 ? 0 : actionAt(state, terminal));
+            if (action.type == 's') {
+                Value value;
+                semantics.shift(token, StackSpan<Value>(values.data(), values.size()), value);
+                values.push_back(move(value));
+                stateStack.push_back(action.value);
+                if (atEnd) return false;
+                advance();
+            } else if (action.type == 'r') {
+                int prodNum = action.value;
+                size_t rightLength = productionRhsLength[prodNum];
+                size_t base = values.size() - rightLength;
+                Value result;
+                semantics.reduce(prodNum, StackSpan<Value>(values.data(), base),
+                                 StackSpan<Value>(values.data() + base, rightLength), result);
+                values.erase(values.begin() + base, values.end());
+                stateStack.resize(stateStack.size() - rightLength);
+                int next = gotoAt(stateStack.back(), productionLhs[prodNum]);
+                if (next < 0) {
+                    reportSyntaxError(stateStack.back(), token, filename);
+                    return false;
+                }
+                stateStack.push_back(next);
+                values.push_back(move(result));
+            } else if (action.type == 'a') {
+                return true;
+            } else {
+                reportSyntaxError(state, token, filename);
+                return false;
             }
-            
-            case 34: { // LoopStmt -> WHILE LPAR Expr RPAR Stmt
-                if (children.size() < 5) return nullptr;
-                auto condition = static_pointer_cast<ExpressionNode>(children[2]);
-                auto body = static_pointer_cast<StatementNode>(children[4]);
-                return make_shared<WhileStmtNode>(condition, body);
+        }
+    }
+    
+    // 从lexer按需取记号进行分析，verbose为true时输出取到的每个记号和分析过程中的提示
+    shared_ptr<ASTNode> parse(Lexer& lexer, bool verbose) {
+        return parseTokens([&](Token& token) { return lexer.next(token); }, lexer.getFilename(), verbose);
+    }
+    
+private:
+    // 按花括号深度切分顶层声明：深度为0处的SEMI结束一个变量声明，
+    // 使深度回到0的RBR结束一个函数定义。返回各声明的记号区间[first, second)
+    static vector<pair<size_t, size_t>> splitTopLevelDecls(const vector<Token>& tokens) {
+        vector<pair<size_t, size_t>> ranges;
+        size_t start = 0;
+        int depth = 0;
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            TokenType type = tokens[i].type;
+            bool end = false;
+            if (type == TokenType::LBR) {
+                depth++;
+            } else if (type == TokenType::RBR) {
+                end = --depth == 0;
+            } else if (type == TokenType::SEMI) {
+                end = depth == 0;
             }
-            
-            case 35: { // RetStmt -> RETURN Expr SEMI
-                if (children.size() < 3) return nullptr;
-                auto returnExpr = static_pointer_cast<ExpressionNode>(children[1]);
-                return make_shared<ReturnStmtNode>(returnExpr);
+            if (end) {
+                ranges.emplace_back(start, i + 1);
+                start = i + 1;
             }
-            
-            case 36: { // RetStmt -> RETURN SEMI
-                if (children.size() < 2) return nullptr;
-                return make_shared<ReturnStmtNode>(nullptr);
+        }
+        if (start < tokens.size()) ranges.emplace_back(start, tokens.size());
+        return ranges;
+    }
+    
+    // 分析的主循环，nextToken(Token&)取下一个记号，没有记号时返回false
+    template <typename NextToken>
+    shared_ptr<ASTNode> parseTokens(NextToken nextToken, const string& filename, bool verbose) {
+        Token currentToken;
+        bool atEnd = false;
+        auto advance = [&]() {
+            if (!nextToken(currentToken)) {
+                // 输入结束，补上EOF记号
+                currentToken = Token();
+                currentToken.type = TokenType::EOF_TOKEN;
+                currentToken.value = "$";
+                currentToken.line = 0;
+                atEnd = true;
             }
-            
-            case 37: { // Expr -> ID ASG Expr (赋值表达式)
-                if (children.size() < 3) return nullptr;
-                auto target = static_pointer_cast<ExpressionNode>(children[0]);
-                auto value = static_pointer_cast<ExpressionNode>(children[2]);
-                return make_shared<AssignmentNode>(target, value);
+            if (verbose) {
+                cout << "token: " << currentToken.value << " (type: " << tokenTypeToString(currentToken.type) << ")\n";
             }
+        };
+        
+        // 语法分析
+        stateStack.clear();
+        nodeStack.clear();
+        stateStack.reserve(STACK_RESERVE);
+        nodeStack.reserve(STACK_RESERVE);
+        stateStack.push_back(0);  // 初始状态
+        startStack.clear();
+        int bypassedStates = stats.bypassedStates;
+        stats = ParseStats();
+        stats.bypassedStates = bypassedStates;
+        
+        size_t tokenIndex = 0;
+        bool buildAST = true;               // 出现语法错误后不再构造AST，只继续检查语法
+        advance();
+        
+        while (true) {
+            int state = stateStack.back();
+            int terminal = tokenTerminal[(int)currentToken.type];
             
-            case 38: { // Expr -> ID LBRACK Expr RBRACK ASG Expr (数组赋值)
-                if (children.size() < 6) return nullptr;
-                auto arrayId = static_pointer_cast<IdentifierNode>(children[0]);
-                auto index = static_pointer_cast<ExpressionNode>(children[2]);
-                auto value = static_pointer_cast<ExpressionNode>(children[5]);
-                auto arrayAccess = make_shared<BinaryOpNode>("[]", arrayId, index);
-                arrayAccess->type = NodeType::ARRAY_ACCESS;
-                return make_shared<AssignmentNode>(arrayAccess, value);
-            }
+            DEBUG_PRINT(cout << "处理token[" << tokenIndex << "]: " << terminalName(currentToken) << " 在状态 " << state << endl);
             
-            case 39: { // Expr -> ID LPAR ArgList RPAR (函数调用)
-                if (children.size() < 4) return nullptr;
-                string funcName = getIdentifierName(children[0]);
-                auto argList = getArgumentList(children[2]);
-                auto funcCall = make_shared<FunctionCallNode>(funcName);
-                for (auto arg : argList) {
-                    funcCall->addArgument(arg);
+            // 增量分析：从当前记号开始有左侧状态相同的旧子树时，把它当作归约结果压栈
+            if (reuse && buildAST) {
+                if (const Subtree* tree = reuse->find(tokenIndex, state)) {
+                    int next = gotoAt(state, tree->symbol);
+                    if (next >= 0) {
+                        stateStack.push_back(next);
+                        nodeStack.push_back(tree->node);
+                        startStack.push_back(tokenIndex);
+                        tokenIndex = reuse->next = tree->last;
+                        reuse->take(*tree);
+                        advance();
+                        continue;
+                    }
                 }
-                return funcCall;
-            }
-            
-            case 40: // Expr -> SimpExpr
-            case 42: // SimpExpr -> AddExpr
-            case 44: // AddExpr -> Term
-            case 46: // Term -> Fact
-            case 47: // Fact -> ID
-                return children.empty() ? nullptr : children[0];
-            
-            case 41: { // SimpExpr -> AddExpr REL_OP AddExpr
-                if (children.size() < 3) return nullptr;
-                auto left = static_pointer_cast<ExpressionNode>(children[0]);
-                string op = getOperatorValue(children[1]);
-                auto right = static_pointer_cast<ExpressionNode>(children[2]);
-                return make_shared<BinaryOpNode>(op, left, right);
             }
             
-            case 43: { // AddExpr -> AddExpr ADD Term
-                if (children.size() < 3) return nullptr;
-                auto left = static_pointer_cast<ExpressionNode>(children[0]);
-                auto right = static_pointer_cast<ExpressionNode>(children[2]);
-                return make_shared<BinaryOpNode>("+", left, right);
+            // 查找ACTION表
+            int16_t code = terminal < 0 ? 0 : actionAt(state, terminal);
+            if (code == 0) {
+                if (failFast) return nullptr;
+                reportSyntaxError(state, currentToken, filename);
+                buildAST = false;
+                if (!recover(currentToken, tokenIndex, atEnd, advance)) return nullptr;
+                continue;
             }
             
-            case 45: { // Term -> Term MUL Fact
-                if (children.size() < 3) return nullptr;
-                auto left = static_pointer_cast<ExpressionNode>(children[0]);
-                auto right = static_pointer_cast<ExpressionNode>(children[2]);
-                return make_shared<BinaryOpNode>("*", left, right);
+            SLRAction action = decode_action(code);
+
+            if (DEBUG_MODE) {
+                cout << "state: " << state << " symbol: " << terminalName(currentToken) << " action: " << action.type << " " << action.value << endl;
             }
             
-            case 48: { // Fact -> ID LBRACK Expr RBRACK
-                if (children.size() < 4) return nullptr;
-                auto arrayId = static_pointer_cast<ExpressionNode>(children[0]);
-                auto index = static_pointer_cast<ExpressionNode>(children[2]);
-                auto arrayAccess = make_shared<BinaryOpNode>("[]", arrayId, index);
-                arrayAccess->type = NodeType::ARRAY_ACCESS;
-                return arrayAccess;
-            }
             
-            case 49: { // Fact -> INT_NUM
-                if (children.size() < 1) {
-                    cerr << "错误：产生式49 (Fact -> INT_NUM) 缺少子节点" << endl;
+            if (action.type == 's') {
+                // 移进
+                stateStack.push_back(action.value);
+                nodeStack.push_back(buildAST ? createTerminalNode(currentToken) : nullptr);
+                if (reuse) startStack.push_back(tokenIndex);
+                tokenIndex++;
+                stats.shifts++;
+                if (atEnd) break;
+                advance();
+            } else if (action.type == 'r') {
+                // 归约
+                int prodNum = action.value;
+                stats.reductions++;
+                
+                // 直通单产生式：节点栈顶就是结果，只需换掉栈顶状态
+                if (passThrough[prodNum]) {
+                    stats.passThroughReductions++;
+                    stateStack.pop_back();
+                    int next = reduceGoto(stateStack.back(), productionLhs[prodNum]);
+                    if (next < 0) {
+                        cerr << "语法错误：GOTO[" << stateStack.back() << ", " << table.nonterminals[productionLhs[prodNum]] << "] 未定义" << endl;
+                        return nullptr;
+                    }
+                    stateStack.push_back(next);
+                    continue;
+                }
+                
+                // 右部各符号的节点就是节点栈顶的rightLength个元素，直接交给语义动作
+                size_t rightLength = productionRhsLength[prodNum];
+                size_t base = nodeStack.size() - rightLength;
+                
+                // 创建新节点
+                shared_ptr<ASTNode> newNode;
+                if (buildAST) {
+                    SemanticAction semanticAction = actions[prodNum];
+                    if (!semanticAction) {
+                        cerr << "错误：产生式 " << prodNum << " 没有绑定语义动作" << endl;
+                        return nullptr;
+                    }
+                    newNode = (this->*semanticAction)(NodeSpan(nodeStack.data() + base, rightLength));
+                    if (!newNode) {
+                        cerr << "创建节点失败，产生式编号: " << prodNum << endl;
+                        return nullptr;
+                    }
+                }
+                
+                // 弹出状态栈和节点栈
+                nodeStack.erase(nodeStack.begin() + base, nodeStack.end());
+                stateStack.resize(stateStack.size() - rightLength);
+                state = stateStack.back();
+                
+                if (reuse) {
+                    size_t first = rightLength > 0 ? startStack[base] : tokenIndex;
+                    startStack.resize(base);
+                    startStack.push_back(first);
+                    if (buildAST && reusableSymbol[productionLhs[prodNum]]) {
+                        reuse->recorded.push_back({first, tokenIndex, state, productionLhs[prodNum], newNode});
+                    }
+                }
+                
+                // 按左部非终结符编号查找GOTO表
+                int next = reduceGoto(state, productionLhs[prodNum]);
+                if (next < 0) {
+                    cerr << "语法错误：GOTO[" << state << ", " << table.nonterminals[productionLhs[prodNum]] << "] 未定义" << endl;
                     return nullptr;
                 }
-                return children[0]; // 返回数字字面量
-            }
-            
-            case 50: { // Fact -> FLOAT_NUM
-                if (children.size() < 1) return nullptr;
-                return children[0]; // 返回浮点数字面量
+                
+                stateStack.push_back(next);
+                nodeStack.push_back(move(newNode));
+            } else if (action.type == 'a') {
+                // 接受；恢复过的输入不产生AST
+                if (!buildAST) return nullptr;
+                if (verbose) cout << "语法分析成功完成！" << endl;
+                return nodeStack.empty() ? nullptr : nodeStack.back();
             }
-            
-            case 51: { // Fact -> LPAR Expr RPAR
-                if (children.size() < 3) return nullptr;
-                return children[1]; // 返回括号中的表达式
+        }
+        
+        if (verbose) {
+            cout << "所有token处理完成，但没有遇到接受状态" << endl;
+            cout << "最终状态栈大小: " << stateStack.size() << endl;
+            cout << "最终节点栈大小: " << nodeStack.size() << endl;
+            if (!nodeStack.empty()) cout << "返回最后的节点" << endl;
+        }
+        return nodeStack.empty() || !buildAST ? nullptr : nodeStack.back();
+    }
+    
+    // 报告语法错误：有ErrorHandler时交给它汇总，否则直接输出到cerr
+    void reportSyntaxError(int state, const Token& token, const string& filename) {
+        string message = "意外的记号 '" + token.value + "' (" + terminalName(token) + ")";
+        // 期望的记号：在当前状态栈上模拟归约（含默认归约）后能被移进的记号。
+        // 只看栈顶的显式表项会漏掉那些要先按默认归约退栈、再在下面的状态移进的记号
+        string expected;
+        for (int t = 0; t < table.terminal_count(); ++t) {
+            if (canShift(stateStack.size(), t)) {
+                expected += string(expected.empty() ? "" : ", ") + table.terminals[t];
             }
-            
-            case 52: { // ArgList -> ArgList COMMA Expr
-                if (children.size() < 3) return nullptr;
-                auto argList = make_shared<CompoundStmtNode>();
-                auto existingArgs = getArgumentList(children[0]);
-                auto newArg = static_pointer_cast<ExpressionNode>(children[2]);
-                for (auto arg : existingArgs) {
-                    argList->addStatement(make_shared<AssignmentNode>(nullptr, arg));
+        }
+        string suggestion = expected.empty() ? "" : "期望以下记号之一: " + expected;
+        if (errorHandler) {
+            errorHandler->reportSyntaxError(message, filename, token.line, 0, suggestion);
+        } else {
+            cerr << "语法错误";
+            if (token.line > 0) cerr << "（第 " << token.line << " 行）";
+            cerr << "：" << message << endl;
+            if (!suggestion.empty()) cerr << "  " << suggestion << endl;
+        }
+        DEBUG_PRINT(cout << "语法错误：状态 " << state << " 没有符号 " << terminalName(token) << " 的动作" << endl);
+    }
+    
+    // 恐慌模式恢复：丢弃输入直到同步记号（见 ErrorHandler::isSynchronizingToken），
+    // 再弹出状态直到栈顶状态能移进该记号，然后从该记号继续分析。跳过的输入中
+    // 花括号成对计数，被丢弃的语句块内部的同步记号不算数。
+    // 到达输入末尾或错误过多时返回false。
+    template <typename Advance>
+    bool recover(const Token& token, size_t& tokenIndex, bool& atEnd, Advance& advance) {
+        if (errorHandler && errorHandler->errorLimitReached()) return false;
+        int depth = 0;
+        while (!atEnd) {
+            if (depth == 0 && ErrorHandler::isSynchronizingToken(terminalName(token))) {
+                int terminal = tokenTerminal[(int)token.type];
+                for (size_t keep = stateStack.size(); keep > 0; --keep) {
+                    if (canShift(keep, terminal)) {
+                        stateStack.resize(keep);
+                        nodeStack.resize(keep - 1);
+                        if (reuse) startStack.resize(keep - 1);
+                        DEBUG_PRINT(cout << "恐慌模式恢复：在记号 " << terminalName(token) << " 处回到状态 " << stateStack.back() << endl);
+                        return true;
+                    }
                 }
-                argList->addStatement(make_shared<AssignmentNode>(nullptr, newArg));
-                return argList;
-            }
-            
-            case 53: { // ArgList -> Expr
-                if (children.size() < 1) return nullptr;
-                auto argList = make_shared<CompoundStmtNode>();
-                auto expr = static_pointer_cast<ExpressionNode>(children[0]);
-                argList->addStatement(make_shared<AssignmentNode>(nullptr, expr));
-                return argList;
             }
-            
-            case 54: { // ArgList -> ε
-                return make_shared<CompoundStmtNode>();
+            if (token.type == TokenType::LBR) depth++;
+            else if (token.type == TokenType::RBR && depth > 0) depth--;
+            advance();
+            tokenIndex++;
+        }
+        return false;
+    }
+    
+    // 只保留状态栈底部keep个状态时，terminal经过若干次归约后能否被移进。
+    // SLR的归约表项按FOLLOW集填写，栈顶状态有表项不代表该记号真能被接受，须模拟归约验证
+    bool canShift(size_t keep, int terminal) {
+        if (terminal < 0) return false;
+        scratchStack.assign(stateStack.begin(), stateStack.begin() + keep);
+        while (true) {
+            SLRAction action = decode_action(actionAt(scratchStack.back(), terminal));
+            if (action.type == 's' || action.type == 'a') return true;
+            if (action.type != 'r') return false;
+            scratchStack.resize(scratchStack.size() - productionRhsLength[action.value]);
+            int next = gotoAt(scratchStack.back(), productionLhs[action.value]);
+            if (next < 0) return false;
+            scratchStack.push_back(next);
+        }
+    }
+    
+    // 分析表查询，按需构造模式下转给 lazyTable
+    int16_t actionAt(int state, int t) {
+        return lazyTable ? lazyTable->action_at(state, t) : table.action_at(state, t);
+    }
+    
+    int gotoAt(int state, int nt) {
+        return lazyTable ? lazyTable->goto_at(state, nt) : table.goto_at(state, nt);
+    }
+    
+    // 分析过程中归约后的GOTO，同时统计单产生式消除省去的归约
+    int reduceGoto(int state, int nt) {
+        return lazyTable ? lazyTable->goto_at(state, nt) : table.goto_at(state, nt, &stats.skippedReductions);
+    }
+    
+    // 由文法导出各产生式的左部编号和右部长度，并按签名绑定语义动作
+    void bindProductions(const Grammar& g) {
+        vector<string> signatures;
+        vector<int> lhs, rhsLength;
+        for (const auto& prod : g.productions) {
+            signatures.push_back(production_signature(prod));
+            lhs.push_back(table.nonterminals.at(prod.left));
+            rhsLength.push_back(prod.right.size());
+        }
+        bindProductions(signatures, lhs, rhsLength);
+    }
+    
+    // 语义动作只是原样返回唯一子节点的单产生式按直通处理，并在查GOTO表时跳过这些归约
+    void bindProductions(const vector<string>& signatures, const vector<int>& lhs, const vector<int>& rhsLength) {
+        stats = ParseStats();
+        productionSignatures = signatures;
+        productionLhs = lhs;
+        productionRhsLength = rhsLength;
+        actions.assign(signatures.size(), nullptr);
+        passThrough.assign(signatures.size(), 0);
+        // 这些非终结符的节点建成后不会再被上层的语义动作修改（StmtList、ParamList等列表节点会），
+        // 可以在增量分析中复用
+        reusableSymbol.assign(table.nonterminal_count(), 0);
+        for (const char* name : {"VarDecl", "FunDecl", "ExprStmt", "CompStmt", "IfStmt", "LoopStmt", "RetStmt"}) {
+            int id = table.nonterminals.find(name);
+            if (id >= 0) reusableSymbol[id] = 1;
+        }
+        const auto& bindings = actionBindings();
+        for (size_t p = 0; p < signatures.size(); ++p) {
+            auto it = bindings.find(signatures[p]);
+            if (it == bindings.end()) {
+                DEBUG_PRINT(cout << "产生式 " << p << " (" << signatures[p] << ") 没有绑定语义动作" << endl);
+                continue;
             }
-            
+            actions[p] = it->second;
+            passThrough[p] = unitElimination && it->second == &SLRParser::actFirstChild && rhsLength[p] == 1;
+        }
+        if (!unitElimination) return;
+        stats.bypassedStates = table.eliminate_unit_reductions(productionLhs, passThrough);
+        DEBUG_PRINT(cout << "单产生式消除：跳过 " << stats.bypassedStates << " 个状态的归约" << endl);
+    }
+    
+    // 记号类型到终结符编号的映射，分析时不再按字符串查表
+    void buildTokenMap() {
+        tokenTerminal.assign((int)TokenType::UNKNOWN + 1, -1);
+        for (int i = 0; i <= (int)TokenType::UNKNOWN; ++i) {
+            TokenType type = (TokenType)i;
+            string name = type == TokenType::EOF_TOKEN ? "#" : tokenTypeToString(type);
+            int id = table.terminals.find(name);
+            if (id >= 0) tokenTerminal[i] = id;
+        }
+    }
+    
+    // 报错和调试输出用的终结符名称
+    string terminalName(const Token& token) const {
+        return token.type == TokenType::EOF_TOKEN ? "#" : tokenTypeToString(token.type);
+    }
+    
+    shared_ptr<ASTNode> createTerminalNode(const Token& token) {
+        switch (token.type) {
+            case TokenType::ID:
+                return make_shared<IdentifierNode>(token.value);
+            case TokenType::INT_NUM:
+                return make_shared<LiteralNode>(token.value, DataType::INT);
+            case TokenType::FLOAT_NUM:
+                return make_shared<LiteralNode>(token.value, DataType::FLOAT);
+            case TokenType::REL_OP:
+                // 关系操作符，创建一个字面量节点来保存操作符值
+                return make_shared<LiteralNode>(token.value, DataType::UNKNOWN);
             default:
-                cerr << "错误：未实现的产生式编号 " << prodNum << endl;
-                cerr << "子节点数量: " << children.size() << endl;
-                for (size_t i = 0; i < children.size(); ++i) {
-                    if (children[i]) {
-                        cerr << "  子节点[" << i << "]: " << nodeTypeToString(children[i]->type) << endl;
-                    } else {
-                        cerr << "  子节点[" << i << "]: nullptr" << endl;
-                    }
-                }
+                // 关键字、ADD/MUL和分隔符不携带值（运算符由产生式确定），节点栈上只占一个空位
                 return nullptr;
         }
     }
     
+    // ===== 语义动作 =====
+    // 每个动作对应一条产生式，children依次为右部各符号的节点（无值的终结符为nullptr）。
+    // 动作通过 actionBindings() 按产生式签名绑定，与产生式编号无关。
+    
+    // 原样返回唯一的子节点（单产生式），右部长度为1时按直通归约处理
+    shared_ptr<ASTNode> actFirstChild(NodeSpan children) {
+        return children.empty() ? nullptr : children[0];
+    }
+    
+    // 不生成节点的产生式：空语句，以及暂不支持的打印语句
+    shared_ptr<ASTNode> actNoNode(NodeSpan children) {
+        return nullptr;
+    }
+    
+    // 将声明加入程序节点
+    static void addDeclaration(shared_ptr<ProgramNode> program, shared_ptr<ASTNode> decl) {
+        if (decl->type == NodeType::VARIABLE_DECL) {
+            program->addGlobalVariable(static_pointer_cast<VariableDeclNode>(decl));
+        } else if (decl->type == NodeType::FUNCTION_DEF) {
+            program->addFunction(static_pointer_cast<FunctionDefNode>(decl));
+        }
+    }
+    
+    shared_ptr<ASTNode> actDeclListAppend(NodeSpan children) {
+        // DeclList -> DeclList Decl
+        if (children.size() < 2) return nullptr;
+        auto program = static_pointer_cast<ProgramNode>(children[0]);
+        addDeclaration(program, children[1]);
+        return program;
+    }
+    
+    shared_ptr<ASTNode> actDeclListFirst(NodeSpan children) {
+        // DeclList -> Decl
+        if (children.empty()) return nullptr;
+        auto program = make_shared<ProgramNode>();
+        addDeclaration(program, children[0]);
+        return program;
+    }
+    
+    shared_ptr<ASTNode> actVarDecl(NodeSpan children) {
+        // VarDecl -> Type ID SEMI
+        if (children.size() < 3) return nullptr;
+        DataType varType = getDataTypeFromNode(children[0]);
+        string varName = getIdentifierName(children[1]);
+        return make_shared<VariableDeclNode>(varType, varName);
+    }
+    
+    shared_ptr<ASTNode> actArrayDecl(NodeSpan children) {
+        // VarDecl -> Type ID LBRACK INT_NUM RBRACK SEMI
+        if (children.size() < 6) return nullptr;
+        DataType baseType = getDataTypeFromNode(children[0]);
+        string varName = getIdentifierName(children[1]);
+        int arraySize = stoi(getLiteralValue(children[3]));
+        
+        DataType arrayType = (baseType == DataType::INT) ? DataType::ARRAY_INT : DataType::ARRAY_FLOAT;
+        auto varDecl = make_shared<VariableDeclNode>(arrayType, varName);
+        varDecl->isArray = true;
+        varDecl->arraySize = arraySize;
+        
+        return varDecl;
+    }
+    
+    shared_ptr<ASTNode> actInitDecl(NodeSpan children) {
+        // VarDecl -> Type ID ASG Expr SEMI
+        if (children.size() < 5) return nullptr;
+        DataType varType = getDataTypeFromNode(children[0]);
+        string varName = getIdentifierName(children[1]);
+        auto initExpr = static_pointer_cast<ExpressionNode>(children[3]);
+        
+        return make_shared<VariableDeclNode>(varType, varName, initExpr);
+    }
+    
+    shared_ptr<ASTNode> actTypeInt(NodeSpan children) {
+        return make_shared<LiteralNode>("int", DataType::INT);
+    }
+    
+    shared_ptr<ASTNode> actTypeFloat(NodeSpan children) {
+        return make_shared<LiteralNode>("float", DataType::FLOAT);
+    }
+    
+    shared_ptr<ASTNode> actTypeVoid(NodeSpan children) {
+        return make_shared<LiteralNode>("void", DataType::VOID);
+    }
+    
+    shared_ptr<ASTNode> actFunDecl(NodeSpan children) {
+        // FunDecl -> Type ID LPAR ParamList RPAR CompStmt
+        if (children.size() < 6) return nullptr;
+        DataType returnType = getDataTypeFromNode(children[0]);
+        string funcName = getIdentifierName(children[1]);
+        auto paramList = static_pointer_cast<ParamListNode>(children[3]);
+        auto body = static_pointer_cast<CompoundStmtNode>(children[5]);
+        
+        auto func = make_shared<FunctionDefNode>(returnType, funcName);
+        func->body = body;
+        // 参数列表不会再被引用，直接取走其中的参数
+        func->parameters = move(paramList->items);
+        
+        return func;
+    }
+    
+    shared_ptr<ASTNode> actParamListAppend(NodeSpan children) {
+        // ParamList -> ParamList COMMA Param：在原列表末尾追加
+        if (children.size() < 3) return nullptr;
+        static_pointer_cast<ParamListNode>(children[0])->append(static_pointer_cast<VariableDeclNode>(children[2]));
+        return children[0];
+    }
+    
+    shared_ptr<ASTNode> actParamListFirst(NodeSpan children) {
+        // ParamList -> Param：创建只包含一个参数的参数列表
+        if (children.empty()) return nullptr;
+        auto paramList = make_shared<ParamListNode>(NodeType::PARAM_LIST);
+        paramList->append(static_pointer_cast<VariableDeclNode>(children[0]));
+        return paramList;
+    }
+    
+    shared_ptr<ASTNode> actEmptyParamList(NodeSpan children) {
+        return make_shared<ParamListNode>(NodeType::PARAM_LIST);
+    }
+    
+    // 空语句列表用空的复合语句节点表示
+    shared_ptr<ASTNode> actEmptyStmtList(NodeSpan children) {
+        return make_shared<CompoundStmtNode>();
+    }
+    
+    shared_ptr<ASTNode> actParam(NodeSpan children) {
+        // Param -> Type ID
+        if (children.size() < 2) return nullptr;
+        DataType paramType = getDataTypeFromNode(children[0]);
+        string paramName = getIdentifierName(children[1]);
+        return make_shared<VariableDeclNode>(paramType, paramName);
+    }
+    
+    shared_ptr<ASTNode> actArrayParam(NodeSpan children) {
+        // Param -> Type ID LBRACK RBRACK
+        if (children.size() < 4) return nullptr;
+        DataType baseType = getDataTypeFromNode(children[0]);
+        string paramName = getIdentifierName(children[1]);
+        DataType arrayType = (baseType == DataType::INT) ? DataType::ARRAY_INT : DataType::ARRAY_FLOAT;
+        auto param = make_shared<VariableDeclNode>(arrayType, paramName);
+        param->isArray = true;
+        return param;
+    }
+    
+    shared_ptr<ASTNode> actCompStmt(NodeSpan children) {
+        // CompStmt -> LBR StmtList RBR：返回StmtList
+        if (children.size() < 3) return nullptr;
+        return children[1];
+    }
+    
+    shared_ptr<ASTNode> actStmtListAppend(NodeSpan children) {
+        // StmtList -> StmtList Stmt
+        if (children.size() < 2) return nullptr;
+        auto stmtList = static_pointer_cast<CompoundStmtNode>(children[0]);
+        auto stmt = static_pointer_cast<StatementNode>(children[1]);
+        stmtList->addStatement(stmt);
+        return stmtList;
+    }
+    
+    shared_ptr<ASTNode> actExprStmt(NodeSpan children) {
+        // ExprStmt -> Expr SEMI：返回表达式
+        if (children.size() < 2) return nullptr;
+        return children[0];
+    }
+    
+    shared_ptr<ASTNode> actIf(NodeSpan children) {
+        // IfStmt -> IF LPAR Expr RPAR CompStmt
+        if (children.size() < 5) return nullptr;
+        auto condition = static_pointer_cast<ExpressionNode>(children[2]);
+        auto thenStmt = static_pointer_cast<StatementNode>(children[4]);
+        return make_shared<IfStmtNode>(condition, thenStmt);
+    }
+    
+    shared_ptr<ASTNode> actIfElse(NodeSpan children) {
+        // IfStmt -> IF LPAR Expr RPAR CompStmt ELSE Stmt
+        if (children.size() < 7) return nullptr;
+        auto condition = static_pointer_cast<ExpressionNode>(children[2]);
+        auto thenStmt = static_pointer_cast<StatementNode>(children[4]);
+        auto elseStmt = static_pointer_cast<StatementNode>(children[6]);
+        return make_shared<IfStmtNode>(condition, thenStmt, elseStmt);
+    }
+    
+    shared_ptr<ASTNode> actWhile(NodeSpan children) {
+        // LoopStmt -> WHILE LPAR Expr RPAR Stmt
+        if (children.size() < 5) return nullptr;
+        auto condition = static_pointer_cast<ExpressionNode>(children[2]);
+        auto body = static_pointer_cast<StatementNode>(children[4]);
+        return make_shared<WhileStmtNode>(condition, body);
+    }
+    
+    shared_ptr<ASTNode> actReturnValue(NodeSpan children) {
+        // RetStmt -> RETURN Expr SEMI
+        if (children.size() < 3) return nullptr;
+        auto returnExpr = static_pointer_cast<ExpressionNode>(children[1]);
+        return make_shared<ReturnStmtNode>(returnExpr);
+    }
+    
+    shared_ptr<ASTNode> actReturnVoid(NodeSpan children) {
+        // RetStmt -> RETURN SEMI
+        if (children.size() < 2) return nullptr;
+        return make_shared<ReturnStmtNode>(nullptr);
+    }
+    
+    shared_ptr<ASTNode> actAssign(NodeSpan children) {
+        // Expr -> ID ASG Expr (赋值表达式)
+        if (children.size() < 3) return nullptr;
+        auto target = static_pointer_cast<ExpressionNode>(children[0]);
+        auto value = static_pointer_cast<ExpressionNode>(children[2]);
+        return make_shared<AssignmentNode>(target, value);
+    }
+    
+    shared_ptr<ASTNode> actArrayAssign(NodeSpan children) {
+        // Expr -> ID LBRACK Expr RBRACK ASG Expr (数组赋值)
+        if (children.size() < 6) return nullptr;
+        auto arrayId = static_pointer_cast<IdentifierNode>(children[0]);
+        auto index = static_pointer_cast<ExpressionNode>(children[2]);
+        auto value = static_pointer_cast<ExpressionNode>(children[5]);
+        auto arrayAccess = make_shared<BinaryOpNode>("[]", arrayId, index);
+        arrayAccess->type = NodeType::ARRAY_ACCESS;
+        return make_shared<AssignmentNode>(arrayAccess, value);
+    }
+    
+    shared_ptr<ASTNode> actCall(NodeSpan children) {
+        // Expr -> ID LPAR ArgList RPAR (函数调用)
+        if (children.size() < 4) return nullptr;
+        string funcName = getIdentifierName(children[0]);
+        auto funcCall = make_shared<FunctionCallNode>(funcName);
+        funcCall->arguments = move(static_pointer_cast<ArgListNode>(children[2])->items);
+        return funcCall;
+    }
+    
+    shared_ptr<ASTNode> actRelOp(NodeSpan children) {
+        // ArithExpr -> ArithExpr REL_OP ArithExpr
+        if (children.size() < 3) return nullptr;
+        auto left = static_pointer_cast<ExpressionNode>(children[0]);
+        string op = getOperatorValue(children[1]);
+        auto right = static_pointer_cast<ExpressionNode>(children[2]);
+        return make_shared<BinaryOpNode>(op, left, right);
+    }
+    
+    shared_ptr<ASTNode> actAdd(NodeSpan children) {
+        // ArithExpr -> ArithExpr ADD ArithExpr
+        if (children.size() < 3) return nullptr;
+        auto left = static_pointer_cast<ExpressionNode>(children[0]);
+        auto right = static_pointer_cast<ExpressionNode>(children[2]);
+        return make_shared<BinaryOpNode>("+", left, right);
+    }
+    
+    shared_ptr<ASTNode> actMul(NodeSpan children) {
+        // ArithExpr -> ArithExpr MUL ArithExpr
+        if (children.size() < 3) return nullptr;
+        auto left = static_pointer_cast<ExpressionNode>(children[0]);
+        auto right = static_pointer_cast<ExpressionNode>(children[2]);
+        return make_shared<BinaryOpNode>("*", left, right);
+    }
+    
+    shared_ptr<ASTNode> actArrayAccess(NodeSpan children) {
+        // ArithExpr -> ID LBRACK Expr RBRACK
+        if (children.size() < 4) return nullptr;
+        auto arrayId = static_pointer_cast<ExpressionNode>(children[0]);
+        auto index = static_pointer_cast<ExpressionNode>(children[2]);
+        auto arrayAccess = make_shared<BinaryOpNode>("[]", arrayId, index);
+        arrayAccess->type = NodeType::ARRAY_ACCESS;
+        return arrayAccess;
+    }
+    
+    shared_ptr<ASTNode> actParen(NodeSpan children) {
+        // ArithExpr -> LPAR Expr RPAR：返回括号中的表达式
+        if (children.size() < 3) return nullptr;
+        return children[1];
+    }
+    
+    shared_ptr<ASTNode> actArgListAppend(NodeSpan children) {
+        // ArgList -> ArgList COMMA Expr：在原列表末尾追加
+        if (children.size() < 3) return nullptr;
+        static_pointer_cast<ArgListNode>(children[0])->append(static_pointer_cast<ExpressionNode>(children[2]));
+        return children[0];
+    }
+    
+    shared_ptr<ASTNode> actArgListFirst(NodeSpan children) {
+        // ArgList -> Expr
+        if (children.size() < 1) return nullptr;
+        auto argList = make_shared<ArgListNode>(NodeType::ARG_LIST);
+        argList->append(static_pointer_cast<ExpressionNode>(children[0]));
+        return argList;
+    }
+    
+    shared_ptr<ASTNode> actEmptyArgList(NodeSpan children) {
+        return make_shared<ArgListNode>(NodeType::ARG_LIST);
+    }
+    
+    // 产生式签名 -> 语义动作，签名格式见 production_signature()
+    static const map<string, SemanticAction>& actionBindings() {
+        static const map<string, SemanticAction> bindings = {
+            {"S' -> Prog", &SLRParser::actFirstChild},
+            {"Prog -> DeclList", &SLRParser::actFirstChild},
+            {"DeclList -> DeclList Decl", &SLRParser::actDeclListAppend},
+            {"DeclList -> Decl", &SLRParser::actDeclListFirst},
+            {"Decl -> VarDecl", &SLRParser::actFirstChild},
+            {"Decl -> FunDecl", &SLRParser::actFirstChild},
+            {"VarDecl -> Type ID SEMI", &SLRParser::actVarDecl},
+            {"VarDecl -> Type ID LBRACK INT_NUM RBRACK SEMI", &SLRParser::actArrayDecl},
+            {"VarDecl -> Type ID ASG Expr SEMI", &SLRParser::actInitDecl},
+            {"Type -> INT", &SLRParser::actTypeInt},
+            {"Type -> FLOAT", &SLRParser::actTypeFloat},
+            {"Type -> VOID", &SLRParser::actTypeVoid},
+            {"FunDecl -> Type ID LPAR ParamList RPAR CompStmt", &SLRParser::actFunDecl},
+            {"ParamList -> ParamList COMMA Param", &SLRParser::actParamListAppend},
+            {"ParamList -> Param", &SLRParser::actParamListFirst},
+            {"ParamList -> ε", &SLRParser::actEmptyParamList},
+            {"Param -> Type ID", &SLRParser::actParam},
+            {"Param -> Type ID LBRACK RBRACK", &SLRParser::actArrayParam},
+            {"CompStmt -> LBR StmtList RBR", &SLRParser::actCompStmt},
+            {"StmtList -> StmtList Stmt", &SLRParser::actStmtListAppend},
+            {"StmtList -> ε", &SLRParser::actEmptyStmtList},
+            {"Stmt -> VarDecl", &SLRParser::actFirstChild},
+            {"Stmt -> OtherStmt", &SLRParser::actFirstChild},
+            {"OtherStmt -> ExprStmt", &SLRParser::actFirstChild},
+            {"OtherStmt -> CompStmt", &SLRParser::actFirstChild},
+            {"OtherStmt -> IfStmt", &SLRParser::actFirstChild},
+            {"OtherStmt -> LoopStmt", &SLRParser::actFirstChild},
+            {"OtherStmt -> RetStmt", &SLRParser::actFirstChild},
+            {"OtherStmt -> PrintStmt", &SLRParser::actFirstChild},
+            {"PrintStmt -> PRINT LPAR Expr RPAR SEMI", &SLRParser::actNoNode},
+            {"ExprStmt -> Expr SEMI", &SLRParser::actExprStmt},
+            {"ExprStmt -> SEMI", &SLRParser::actNoNode},
+            {"IfStmt -> IF LPAR Expr RPAR CompStmt", &SLRParser::actIf},
+            {"IfStmt -> IF LPAR Expr RPAR CompStmt ELSE Stmt", &SLRParser::actIfElse},
+            {"LoopStmt -> WHILE LPAR Expr RPAR Stmt", &SLRParser::actWhile},
+            {"RetStmt -> RETURN Expr SEMI", &SLRParser::actReturnValue},
+            {"RetStmt -> RETURN SEMI", &SLRParser::actReturnVoid},
+            {"Expr -> ID ASG Expr", &SLRParser::actAssign},
+            {"Expr -> ID LBRACK Expr RBRACK ASG Expr", &SLRParser::actArrayAssign},
+            {"Expr -> ID LPAR ArgList RPAR", &SLRParser::actCall},
+            {"Expr -> ArithExpr", &SLRParser::actFirstChild},
+            {"ArithExpr -> ArithExpr REL_OP ArithExpr", &SLRParser::actRelOp},
+            {"ArithExpr -> ArithExpr ADD ArithExpr", &SLRParser::actAdd},
+            {"ArithExpr -> ArithExpr MUL ArithExpr", &SLRParser::actMul},
+            {"ArithExpr -> ID", &SLRParser::actFirstChild},
+            {"ArithExpr -> ID LBRACK Expr RBRACK", &SLRParser::actArrayAccess},
+            {"ArithExpr -> INT_NUM", &SLRParser::actFirstChild},
+            {"ArithExpr -> FLOAT_NUM", &SLRParser::actFirstChild},
+            {"ArithExpr -> LPAR Expr RPAR", &SLRParser::actParen},
+            {"ArgList -> ArgList COMMA Expr", &SLRParser::actArgListAppend},
+            {"ArgList -> Expr", &SLRParser::actArgListFirst},
+            {"ArgList -> ε", &SLRParser::actEmptyArgList},
+        };
+        return bindings;
+    }
+    
     // 辅助函数实现
-    DataType getDataTypeFromNode(shared_ptr<ASTNode> node) {
+    DataType getDataTypeFromNode(const shared_ptr<ASTNode>& node) {
         if (!node) {
             cerr << "警告：getDataTypeFromNode 收到空节点" << endl;
             return DataType::UNKNOWN;
@@ -2164,7 +3826,7 @@ private:
         return DataType::UNKNOWN;
     }
     
-    string getIdentifierName(shared_ptr<ASTNode> node) {
+    string getIdentifierName(const shared_ptr<ASTNode>& node) {
         if (!node) {
             cerr << "警告：getIdentifierName 收到空节点" << endl;
             return "";
@@ -2176,7 +3838,7 @@ private:
         return "";
     }
     
-    string getLiteralValue(shared_ptr<ASTNode> node) {
+    string getLiteralValue(const shared_ptr<ASTNode>& node) {
         if (!node) {
             cerr << "警告：getLiteralValue 收到空节点" << endl;
             return "";
@@ -2188,7 +3850,7 @@ private:
         return "";
     }
     
-    string getOperatorValue(shared_ptr<ASTNode> node) {
+    string getOperatorValue(const shared_ptr<ASTNode>& node) {
         // 操作符可能以不同方式表示，这里提供更完善的处理
         if (auto literal = static_pointer_cast<LiteralNode>(node)) {
             return literal->value;
@@ -2210,52 +3872,271 @@ private:
         }
         return "";
     }
+};
+
+// ===== 增量分析 =====
+// 编辑器、监视模式下文件每次只改动少量行。保存上次分析时各行的文本和记号以及可复用的子树，
+// 重新分析时只对改动的行做词法分析，语法分析复用改动范围以外的语句和声明，
+// 词法和语法分析的工作量与改动的大小而不是文件的大小成正比
+class IncrementalParser {
+public:
+    struct Stats {
+        size_t relexedLines = 0;     // 重新做词法分析的行数
+        size_t tokens = 0;           // 记号总数
+        size_t reusedSubtrees = 0;   // 直接复用的子树数
+    };
     
-    vector<shared_ptr<VariableDeclNode>> getParameterList(shared_ptr<ASTNode> node) {
-        vector<shared_ptr<VariableDeclNode>> params;
-        if (auto compound = static_pointer_cast<CompoundStmtNode>(node)) {
-            for (auto stmt : compound->statements) {
-                if (auto param = static_pointer_cast<VariableDeclNode>(stmt)) {
-                    params.push_back(param);
-                }
+    IncrementalParser(SLRParser& parser, const string& filename)
+        : parser(parser), filename(filename), lexer(filename, true) {}
+    
+    // 重新读入文件并分析，第一次调用时分析整个文件
+    shared_ptr<ASTNode> reparse() {
+        vector<string> newLines;
+        {
+            ifstream file(filename);
+            string line;
+            while (getline(file, line)) newLines.push_back(line);
+        }
+        
+        // 首尾未改动的行
+        size_t prefixLines = 0;
+        size_t common = min(lines.size(), newLines.size());
+        while (prefixLines < common && lines[prefixLines] == newLines[prefixLines]) prefixLines++;
+        size_t suffixLines = 0;
+        while (suffixLines < common - prefixLines &&
+               lines[lines.size() - 1 - suffixLines] == newLines[newLines.size() - 1 - suffixLines]) {
+            suffixLines++;
+        }
+        size_t oldTokens = tokens.size();
+        size_t prefixTokens = 0, suffixTokens = 0;
+        for (size_t i = 0; i < prefixLines; ++i) prefixTokens += lineTokens[i].size();
+        for (size_t i = lines.size() - suffixLines; i < lines.size(); ++i) suffixTokens += lineTokens[i].size();
+        
+        // 只对中间改动的行重新做词法分析
+        size_t changedLines = newLines.size() - prefixLines - suffixLines;
+        vector<vector<Token>> relexed(changedLines);
+        for (size_t i = 0; i < changedLines; ++i) {
+            lexer.tokenizeLine(newLines[prefixLines + i], prefixLines + i + 1, relexed[i]);
+        }
+        lineTokens.erase(lineTokens.begin() + prefixLines, lineTokens.end() - suffixLines);
+        lineTokens.insert(lineTokens.begin() + prefixLines,
+                          make_move_iterator(relexed.begin()), make_move_iterator(relexed.end()));
+        lines = move(newLines);
+        
+        // 改动之后的行整体移动，行号随之更新
+        tokens.clear();
+        for (size_t i = 0; i < lineTokens.size(); ++i) {
+            for (auto& token : lineTokens[i]) {
+                token.line = i + 1;
+                tokens.push_back(token);
             }
         }
-        return params;
-    }
-    
-    vector<shared_ptr<ExpressionNode>> getArgumentList(shared_ptr<ASTNode> node) {
-        vector<shared_ptr<ExpressionNode>> args;
-        if (auto compound = static_pointer_cast<CompoundStmtNode>(node)) {
-            for (auto stmt : compound->statements) {
-                if (auto assign = static_pointer_cast<AssignmentNode>(stmt)) {
-                    if (assign->value) {
-                        args.push_back(assign->value);
-                    }
-                }
+        
+        // 可复用的子树：连同其后的一个记号都在未改动的前缀内，或者整个在未改动的后缀内
+        SLRParser::ReuseContext context;
+        size_t suffixStart = oldTokens - suffixTokens;
+        for (const auto& tree : subtrees) {
+            if (tree.last < prefixTokens) {
+                context.reusable.push_back(tree);
+            } else if (tree.first >= suffixStart) {
+                context.reusable.push_back(tree);
+                context.reusable.back().first = tree.first - oldTokens + tokens.size();
+                context.reusable.back().last = tree.last - oldTokens + tokens.size();
             }
         }
-        return args;
+        
+        // 有语法错误时，错误之前建成的子树仍然可以留给下一次
+        auto ast = parser.parseIncremental(tokens, filename, context);
+        subtrees = move(context.recorded);
+        sort(subtrees.begin(), subtrees.end(), [](const SLRParser::Subtree& a, const SLRParser::Subtree& b) {
+            return a.first != b.first ? a.first < b.first : a.last > b.last;
+        });
+        stats.relexedLines = changedLines;
+        stats.tokens = tokens.size();
+        stats.reusedSubtrees = context.reused;
+        return ast;
     }
+    
+    const Stats& getStats() const { return stats; }
+    
+private:
+    SLRParser& parser;
+    string filename;
+    Lexer lexer;                            // 只用来分析单行
+    vector<string> lines;
+    vector<vector<Token>> lineTokens;       // 各行的记号
+    vector<Token> tokens;
+    vector<SLRParser::Subtree> subtrees;    // 上次分析得到的子树，按first升序、同first时外层在前
+    Stats stats;
 };
 
 #ifdef SEMANTIC_ANALYZER_MAIN
+// --watch：监视输入文件，每次修改后增量地重新分析并做语义分析，直到进程被终止
+static int watchFile(SLRParser& parser, ErrorHandler& errorHandler, const string& filename) {
+    IncrementalParser incremental(parser, filename);
+    struct timespec lastModified = {0, 0};
+    for (int round = 1;; ) {
+        struct stat st;
+        if (stat(filename.c_str(), &st) == 0 &&
+            (st.st_mtim.tv_sec != lastModified.tv_sec || st.st_mtim.tv_nsec != lastModified.tv_nsec)) {
+            lastModified = st.st_mtim;
+            errorHandler.clear();
+            errorHandler.loadSourceFile(filename);
+            auto t0 = chrono::steady_clock::now();
+            auto ast = incremental.reparse();
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+            const auto& stats = incremental.getStats();
+            cout << "[" << round++ << "] 语法分析用时 " << fixed << setprecision(2) << ms << " ms："
+                 << "重新分析 " << stats.relexedLines << " 行，共 " << stats.tokens << " 个记号，复用 "
+                 << stats.reusedSubtrees << " 棵子树" << endl;
+            if (ast) {
+                SemanticAnalyzer analyzer;
+                bool ok = analyzer.analyzeProgram(static_pointer_cast<ProgramNode>(ast));
+                cout << (ok ? "✅ 语义分析成功完成" : "❌ 语义分析发现错误") << endl;
+            } else {
+                if (errorHandler.getErrorCount() > 0) errorHandler.printAllErrors();
+                cout << "❌ 语法分析失败" << endl;
+            }
+        }
+        this_thread::sleep_for(chrono::milliseconds(200));
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    string inputFile, grammarFile, tableCacheDir;
+    bool showStats = false, unitElimination = true, lazyTable = false, quiet = false, syntaxOnly = false;
+    bool watch = false, flatAST = false, emitASTJson = false, emitASTBinary = false, loadAST = false;
+    bool hashCons = false;
+    int threadCount = 1;
+    vector<string> inputFiles;
     for (int i = 1; i < argc; i++) {
-        if (string(argv[i]) == "--debug" || string(argv[i]) == "-d") {
+        string arg = argv[i];
+        if (arg == "--debug" || arg == "-d") {
             DEBUG_MODE = true;
+        } else if (arg == "--stats") {
+            showStats = true;
+        } else if (arg == "--no-unit-elim") {
+            unitElimination = false;
+        } else if (arg == "--lazy-table") {
+            lazyTable = true;
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--syntax-only") {
+            syntaxOnly = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "--flat-ast") {
+            flatAST = true;
+        } else if (arg == "--emit-ast-json") {
+            emitASTJson = true;
+        } else if (arg == "--emit-ast-bin") {
+            emitASTBinary = true;
+        } else if (arg == "--load-ast") {
+            loadAST = true;
+        } else if (arg == "--hash-cons") {
+            hashCons = true;
+        } else if (arg == "--grammar" && i + 1 < argc) {
+            grammarFile = argv[++i];
+        } else if (arg == "--table-cache" && i + 1 < argc) {
+            tableCacheDir = argv[++i];
+        } else {
+            inputFile = arg;
+            inputFiles.push_back(arg);
+        }
+    }
+    
+    // 指定了其他文法或按需构造时不必先装入内置的分析表
+    SLRParser slrparser(unitElimination, grammarFile.empty() && !lazyTable);
+    // 语法错误经恐慌模式恢复后继续分析，全部汇总到errorHandler
+    ErrorHandler errorHandler;
+    errorHandler.loadSourceFile(inputFile);
+    slrparser.setErrorHandler(&errorHandler);
+    if (!grammarFile.empty()) {
+        vector<string> rules;
+        if (!read_grammar_rules(grammarFile, rules)) {
+            cerr << "无法打开文法文件: " << grammarFile << endl;
+            return 1;
+        }
+        if (lazyTable) {
+            slrparser.loadLazySLRTable(rules);
+        } else {
+            slrparser.loadSLRTable(rules, tableCacheDir);
         }
+    } else if (lazyTable) {
+        slrparser.loadLazySLRTable();
     }
     
-    SLRParser slrparser;
-    slrparser.loadSLRTable();
-    auto ast = slrparser.parse(argv[1]);
+    if (syntaxOnly) {
+        // --syntax-only：只检查各输入文件是否符合文法，不构造AST，也不做语义分析
+        int failed = 0;
+        for (const auto& file : inputFiles) {
+            auto result = slrparser.validate(file);
+            if (result.accepted) {
+                cout << file << ": 语法正确\n";
+            } else {
+                failed++;
+                cout << file << ":" << result.line << ": 语法错误，意外的记号 '" << result.token << "'\n";
+            }
+        }
+        return failed > 0 ? 1 : 0;
+    }
+    
+    if (watch) return watchFile(slrparser, errorHandler, inputFile);
+    
+    // --quiet：语法分析不输出记号和AST；
+    // --threads N（N>1）：按顶层声明并行分析，同样不输出
+    // --load-ast：输入文件是--emit-ast-bin写出的二进制AST，不做语法分析
+    shared_ptr<ASTNode> ast;
+    if (loadAST) {
+        ast = loadBinaryAST(inputFile);
+        if (!ast) {
+            cerr << "无法读取二进制AST文件: " << inputFile << endl;
+            return 1;
+        }
+    } else if (threadCount > 1) {
+        ast = slrparser.parseParallel(inputFile, threadCount);
+    } else {
+        ast = quiet ? slrparser.parseQuiet(inputFile) : slrparser.parse(inputFile);
+    }
+    // --emit-ast-json：把AST写入ast.json；--emit-ast-bin：写入二进制的ast.bin
+    if (emitASTJson && ast) saveASTtoJSON(ast, "ast.json");
+    if (emitASTBinary && ast) {
+        if (saveBinaryAST(ast, "ast.bin")) {
+            cout << "AST已保存到文件: ast.bin" << endl;
+        } else {
+            cerr << "无法写入文件: ast.bin" << endl;
+        }
+    }
+    if (showStats) {
+        const auto& stats = slrparser.getStats();
+        cout << "\n=== 分析统计 ===" << endl;
+        cout << "移进次数: " << stats.shifts << endl;
+        cout << "归约次数: " << stats.reductions << "（其中直通处理、只换栈顶状态不调用语义动作的 " << stats.passThroughReductions << " 次）" << endl;
+        cout << "单产生式消除省去的归约: " << stats.skippedReductions << " 次（跳过归约的状态 " << stats.bypassedStates << " 个）" << endl;
+        if (const LazySLRTable* lazy = slrparser.getLazyTable()) {
+            cout << "按需构造的状态: 已构造 " << lazy->expanded_count() << ", 已发现 " << lazy->state_count() << endl;
+        }
+    }
     
     // 如果语法分析成功，进行语义分析
     if (ast) {
         if (auto program = static_pointer_cast<ProgramNode>(ast)) {
             cout << "\n开始语义分析..." << endl;
             SemanticAnalyzer analyzer;
-            bool semanticSuccess = analyzer.analyzeProgram(program);
+            // --hash-cons：先合并结构相同的纯表达式，语义分析时按节点缓存表达式类型
+            if (hashCons) {
+                ExpressionTable table;
+                table.internTree(ast);
+                analyzer.enableTypeCache();
+                if (showStats) {
+                    cout << "哈希合并: " << table.visitedCount() << " 处表达式，其中不同的纯表达式 " << table.uniqueCount() << " 个" << endl;
+                }
+            }
+            // --flat-ast：先转换为扁平AST，在其上做语义分析
+            bool semanticSuccess = flatAST ? analyzer.analyzeProgram(FlatAST(ast)) : analyzer.analyzeProgram(program);
             
             if (semanticSuccess) {
                 cout << "\n✅ 语义分析成功完成！" << endl;
@@ -2267,6 +4148,7 @@ int main(int argc, char* argv[]) {
             cout << "\n警告：AST根节点不是Program类型" << endl;
         }
     } else {
+        if (errorHandler.getErrorCount() > 0) errorHandler.printAllErrors();
         cout << "\n❌ 语法分析失败，无法进行语义分析。" << endl;
         return 1;
     }